@@ -22,6 +22,27 @@ import {
 } from 'class-validator';
 import { ScoreQueryHide, ScoreQueryInclude } from './Replay';
 import { stringify } from 'flatted';
+import { DOWNLOAD_PING_WINDOW_MS, MAX_BATCH_IDS } from '@util/constants';
+
+// when each client's download of each level was last counted, by `${client} ${levelId}`
+const lastDownloadPings = new Map<string, number>();
+// past this many, expired entries are swept out
+const MAX_TRACKED_PINGS = 100000;
+
+// should a client's download of a level count, i.e. it hasn't already within the window
+function countDownloadPing(client: string, id: number): boolean {
+	const now = Date.now();
+	if (lastDownloadPings.size > MAX_TRACKED_PINGS) {
+		for (const [key, at] of lastDownloadPings) {
+			if (now - at >= DOWNLOAD_PING_WINDOW_MS) lastDownloadPings.delete(key);
+		}
+	}
+	const key = `${client} ${id}`;
+	const last = lastDownloadPings.get(key);
+	if (last != undefined && now - last < DOWNLOAD_PING_WINDOW_MS) return false;
+	lastDownloadPings.set(key, now);
+	return true;
+}
 
 const SortableFields = [
 	'id',
@@ -189,6 +210,41 @@ export default class Level {
 
 		return res.status(200).send('ok');
 	}
+
+	/**
+	 * register a batch of level downloads at once. each client's download of a level counts at most once
+	 * per DOWNLOAD_PING_WINDOW_MS, clients being users if logged in & addresses otherwise
+	 *
+	 * @static
+	 * @async
+	 * @param {number[]} req.body.ids the downloaded level ids
+	 */
+	static async downloadPings(req: Request, res: Response) {
+		const token: tools.IAuthToken | undefined = res.locals.token;
+		const ids = tools.batchIds(req.body, MAX_BATCH_IDS);
+		if (!ids) {
+			return res.status(400).send({ error: `Expected an array of at most ${MAX_BATCH_IDS} level ids` });
+		}
+		const client = token ? `user:${token.id}` : `ip:${req.ip}`;
+		const counted = ids.filter((id) => countDownloadPing(client, id));
+		if (counted.length == 0) return res.status(200).send('ok');
+
+		log.info(`Level IDs ${counted.join(', ')} download pinged`);
+		await prisma.level
+			.updateMany({
+				where: {
+					id: { in: counted },
+				},
+				data: {
+					downloads: {
+						increment: 1,
+					},
+				},
+			})
+			.catch((err) => undefined);
+
+		return res.status(200).send('ok');
+	}
 	/**
 	 * search through all levels
 	 *
@@ -328,6 +384,38 @@ export default class Level {
 		}
 	}
 
+	/**
+	 * fetch many levels at once. downloads are counted separately, by ping-downloads
+	 *
+	 * @static
+	 * @async
+	 * @param {number[]} req.body.ids
+	 */
+	static async getByIds(req: Request, res: Response) {
+		const token: tools.IAuthToken | undefined = res.locals.token;
+		const ids = tools.batchIds(req.body, MAX_BATCH_IDS);
+		if (!ids) {
+			return res.status(400).send({ error: `Expected an array of at most ${MAX_BATCH_IDS} level ids` });
+		}
+
+		try {
+			const levels = await prisma.level.findMany({
+				where: {
+					id: { in: ids },
+				},
+				...LevelQueryInclude(token?.id),
+			});
+			return res.status(200).send({
+				levels: levels.map((level) => tools.toLevelResponse(level, token?.id)),
+			});
+		} catch (e) {
+			log.error(e);
+			return res.status(500).send({
+				error: 'Internal server error (NO_FETCH_LEVELS)',
+			});
+		}
+	}
+
 	static async getQuickplay(req: Request, res: Response) {
 		try {
 			const token: tools.IAuthToken | undefined = res.locals.token;
@@ -5,8 +5,9 @@ import { stringify } from 'flatted';
 
 import { prisma } from '@db/index';
 import log from '@/log';
+import { MAX_BATCH_IDS } from '@util/constants';
 
-import { IsIn, IsInt, IsNumber, IsOptional, Max, Min, validate } from 'class-validator';
+import { IsBoolean, IsIn, IsInt, IsNumber, IsOptional, Max, Min, validate } from 'class-validator';
 
 const SortableFields = ['time', 'author', 'createdAt', 'updatedAt'] as const;
 const SortDirections = ['asc', 'desc'] as const;
@@ -30,6 +31,10 @@ export class IReplaySearchOptions {
 
 	@IsIn(SortDirections)
 	order!: typeof SortDirections[number];
+
+	// leave out each replay's data, for clients that fetch it when it's played
+	@IsBoolean({ message: 'Malformed raw' })
+	raw!: boolean;
 }
 
 export interface IReplayResponse {
@@ -173,6 +178,27 @@ export default class Replay {
 		}
 	}
 
+	// fetch many replays at once
+	static async getByIds(req: Request, res: Response) {
+		const token: tools.IAuthToken | undefined = res.locals.token;
+		const ids = tools.batchIds(req.body, MAX_BATCH_IDS);
+		if (!ids) {
+			return res.status(400).send({ error: `Expected an array of at most ${MAX_BATCH_IDS} replay ids` });
+		}
+		try {
+			const replays = await prisma.userLevelScore.findMany({
+				where: {
+					id: { in: ids },
+					...ScoreQueryHide(token?.id),
+				},
+				...ScoreQueryInclude,
+			});
+			return res.status(200).send({ replays: replays.map((replay) => tools.toReplayResponse(replay)) });
+		} catch (e) {
+			return res.status(500).send({ error: 'Internal server error (NO_FETCH_RPLS)' });
+		}
+	}
+
 	// search for replays
 	static async search(req: Request, res: Response) {
 		const token: tools.IAuthToken | undefined = res.locals.token;
@@ -187,6 +213,7 @@ export default class Replay {
 			opts.levelId = levelId;
 			opts.order = req.body.order ?? 'asc';
 			opts.sortBy = req.body.sortBy ?? 'time';
+			opts.raw = req.body.raw ?? true;
 			const errors = await validate(opts);
 			if (errors?.length > 0) {
 				return res.status(400).send({
@@ -222,7 +249,7 @@ export default class Replay {
 		const lastScore = scores[scores.length - 1];
 
 		return res.status(200).send({
-			scores: scores.map((score) => tools.toReplayResponse(score)),
+			scores: scores.map((score) => tools.toReplayResponse(score, opts.raw)),
 			cursor: lastScore?.id && scores.length >= opts.limit ? lastScore.id : -1,
 		});
 	}
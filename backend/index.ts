@@ -13,7 +13,7 @@ import Replay from '@controllers/Replay';
 import Comment from '@controllers/Comment';
 import User from '@controllers/User';
 
-import { checkAuth, requireAuth } from '@util/tools';
+import { checkAuth, compressResponses, requireAuth } from '@util/tools';
 
 import http from 'http';
 import https from 'https';
@@ -21,6 +21,7 @@ import https from 'https';
 const app = express();
 app.use(express.json());
 app.use(express.urlencoded({ extended: true }));
+app.use(compressResponses());
 
 app.use((req: Request, _: Response, next: NextFunction) => {
 	log.info(`${req.method} ${req.originalUrl}`);
@@ -38,14 +39,17 @@ app.post('/level/upload/:confirm?', requireAuth(0), Level.upload);
 app.post('/level/search', checkAuth(), Level.search);
 app.get('/level/quickplay', checkAuth(), Level.getQuickplay);
 app.get('/level/:id/ping-download', Level.downloadPing);
+app.post('/level/ping-downloads', checkAuth(), Level.downloadPings);
 app.post('/level/:id(\\d+)/:vote(like|dislike)', requireAuth(0), Level.vote);
 app.post('/level/:id(\\d+)', checkAuth(), Level.getById);
+app.post('/level/batch', checkAuth(), Level.getByIds);
 app.post('/level/:id(\\d+)/pin', requireAuth(0), User.pinLevel(true));
 app.post('/level/unpin', requireAuth(0), User.pinLevel(false));
 
 app.post('/replay/upload', requireAuth(0), Replay.upload);
 app.post('/replay/search/:levelId(\\d+)', checkAuth(), Replay.search);
 app.post('/replay/:id(\\d+)', checkAuth(), Replay.get);
+app.post('/replay/batch', checkAuth(), Replay.getByIds);
 app.post('/replay/:id(\\d+)/:hide(hide|unhide)', requireAuth(0), Replay.hide);
 
 app.post('/set-player-color', requireAuth(0), User.setColor);
@@ -1,5 +1,14 @@
 import log from '@/log';
-import { MP_FLUSH_INTERVAL_MS } from '@/util/constants';
+import {
+	MP_FAR_FLUSH_EVERY,
+	MP_FLUSH_INTERVAL_MS,
+	MP_MAX_INTEREST,
+	MP_POS_SCALE,
+	MP_STATE_MASK_SIZE,
+	MP_STATE_POS_OFFSET,
+	MP_STATE_SIZE,
+	MP_STATE_VERSION,
+} from '@/util/constants';
 import { prisma } from '@db/index';
 import { User } from '@prisma/client';
 import http from 'http';
@@ -32,47 +41,52 @@ function isValidData(data: IPlayerData): boolean {
 	return true;
 }
 
-interface ControlVars {
-	xp: number;
-	yp: number;
-	xv: number;
-	yv: number;
-	sx: number;
-	sy: number;
-	climbing: boolean;
-	dashing: boolean;
-	jumping: boolean;
-	dash_dir: number;
-	climbing_facing: number;
-	since_wallkick_ms: number;
-	time_airborne_ms: number;
-
-	this_frame: number;
-	last_frame: number;
-	grounded: boolean;
-	facing: number;
-	against_ladder_left: boolean;
-	against_ladder_right: boolean;
-	can_wallkick_left: boolean;
-	can_wallkick_right: boolean;
-	on_ice: boolean;
-	flip_gravity: boolean;
-	alt_controls: boolean;
-	tile_above: boolean;
-}
-
-interface IPlayerState {
-	id?: number;
-	controls?: ControlVars;
-	anim?: string;
-	updatedAt?: number;
+// packed player states are opaque to the server besides the leading version byte & player id
+const STATE_ID_OFFSET = 1;
+
+// kinds of state_update a client sends
+enum UpdateKind {
+	Keyframe = 0, // u16 seq, the whole packed state
+	Delta = 1, // u16 seq, u16 base seq, bitmask of changed bytes, the changed bytes
+	Heartbeat = 2, // u16 seq of the state we should still have
 }
 
-function isValidState(state: IPlayerState): boolean {
-	if (state.id == undefined) return false;
-	if (state.controls == undefined) return false;
-	if (state.updatedAt == undefined) return false;
-	return true;
+interface IStoredState {
+	seq: number;
+	state: Buffer;
+}
+
+// apply a state_update to a player's stored state. returns the new state, the same one if nothing changed,
+// or undefined if the update can't be applied and the client needs to send a keyframe
+function applyStateUpdate(stored: IStoredState | undefined, update: Buffer): IStoredState | undefined {
+	if (update.length < 3) return;
+	const kind = update[0];
+	const seq = update.readUInt16LE(1);
+	switch (kind) {
+		case UpdateKind.Keyframe: {
+			if (update.length != 3 + MP_STATE_SIZE) return;
+			const state = Buffer.from(update.subarray(3));
+			if (state[0] != MP_STATE_VERSION) return;
+			return { seq, state };
+		}
+		case UpdateKind.Delta: {
+			if (stored == undefined || update.length < 5 + MP_STATE_MASK_SIZE) return;
+			if (update.readUInt16LE(3) != stored.seq) return;
+			const state = Buffer.from(stored.state);
+			let at = 5 + MP_STATE_MASK_SIZE;
+			for (let i = 0; i < MP_STATE_SIZE; ++i) {
+				if ((update[5 + (i >> 3)] & (1 << (i & 7))) == 0) continue;
+				if (at >= update.length) return;
+				state[i] = update[at++];
+			}
+			if (at != update.length || state[0] != MP_STATE_VERSION) return;
+			return { seq, state };
+		}
+		case UpdateKind.Heartbeat:
+			if (stored == undefined || seq != stored.seq) return;
+			return stored;
+	}
+	return;
 }
 
 interface IMessage {
@@ -91,8 +105,107 @@ export function emitUserData(user: User) {
 	io?.emit('data_update', [data]);
 }
 
-// player states are queued and distributed at a fixed interval
-const ROOMS: { [room: string]: { [id: number]: IPlayerState } } = {};
+// player states are queued and distributed at a fixed interval, only the ones that changed since the last flush
+const ROOMS: { [room: string]: { [id: number]: IStoredState } } = {};
+const DIRTY: { [room: string]: Set<number> } = {};
+
+function dropState(room: string, id: number) {
+	delete ROOMS[room]?.[id];
+	DIRTY[room]?.delete(id);
+	if (ROOMS[room] != undefined && Object.keys(ROOMS[room]).length == 0) {
+		delete ROOMS[room];
+		delete DIRTY[room];
+	}
+}
+
+// a client's hint of whose states it cares about most: the `max` players nearest to (x, y), in tiles
+interface IInterest {
+	x: number;
+	y: number;
+	max: number;
+	pending: Set<number>; // players whose newest state the client hasn't been sent yet
+}
+const INTEREST: { [socketId: string]: IInterest } = {};
+
+function statePosition(state: Buffer): [number, number] {
+	return [
+		state.readInt32LE(MP_STATE_POS_OFFSET) / MP_POS_SCALE,
+		state.readInt32LE(MP_STATE_POS_OFFSET + 4) / MP_POS_SCALE,
+	];
+}
+
+// every player's position in a room, decoded once per flush and shared by all the room's clients
+interface IRoomPositions {
+	ids: number[];
+	xs: Float64Array;
+	ys: Float64Array;
+}
+
+function roomPositions(room: string): IRoomPositions {
+	const states = ROOMS[room] ?? {};
+	const ids = Object.keys(states).map((id) => parseInt(id));
+	const xs = new Float64Array(ids.length);
+	const ys = new Float64Array(ids.length);
+	ids.forEach((id, i) => {
+		[xs[i], ys[i]] = statePosition(states[id].state);
+	});
+	return { ids, xs, ys };
+}
+
+// reorders ids & dists (in step) so the k smallest dists come first, in no particular order. O(n) on average
+function selectNearest(ids: number[], dists: Float64Array, k: number) {
+	const swap = (i: number, j: number) => {
+		[ids[i], ids[j]] = [ids[j], ids[i]];
+		[dists[i], dists[j]] = [dists[j], dists[i]];
+	};
+	let lo = 0;
+	let hi = ids.length - 1;
+	while (lo < hi) {
+		swap(lo + Math.floor(Math.random() * (hi - lo + 1)), hi);
+		const pivot = dists[hi];
+		let store = lo;
+		for (let i = lo; i < hi; ++i) {
+			if (dists[i] < pivot) swap(i, store++);
+		}
+		swap(store, hi);
+		if (store == k - 1 || store == k) return;
+		if (store < k) lo = store + 1;
+		else hi = store - 1;
+	}
+}
+
+// the pending states to send a client this flush. the nearest go out every time, the rest only on far flushes
+function takeInterestingStates(
+	room: string,
+	self: number,
+	interest: IInterest,
+	far: boolean,
+	positions: () => IRoomPositions
+): Buffer[] {
+	const states = ROOMS[room] ?? {};
+	for (const id of interest.pending) {
+		if (id == self || states[id] == undefined) interest.pending.delete(id);
+	}
+	let ids = [...interest.pending];
+	if (!far && ids.length > 0) {
+		const all = positions();
+		const others: number[] = [];
+		const dists = new Float64Array(all.ids.length);
+		all.ids.forEach((id, i) => {
+			if (id == self) return;
+			dists[others.length] = Math.hypot(all.xs[i] - interest.x, all.ys[i] - interest.y);
+			others.push(id);
+		});
+		// only which players are nearest matters, not their order, so there's no need to sort everyone
+		if (others.length > interest.max) {
+			selectNearest(others, dists.subarray(0, others.length), interest.max);
+		}
+		const near = new Set(others.slice(0, interest.max));
+		ids = ids.filter((id) => near.has(id));
+	}
+	for (const id of ids) interest.pending.delete(id);
+	return ids.map((id) => states[id].state);
+}
 
 export function playerCount(levelId: number): number {
 	return io?.sockets?.adapter?.rooms?.get(`${levelId}`)?.size ?? 0;
@@ -105,7 +218,7 @@ async function postAuthentication(socket: Socket) {
 	log.info(`user ${data.name} connected`);
 
 	socket.onAny((event) => {
-		if (event === 'state_update') return;
+		if (event === 'state_update' || event === 'clock_sync') return;
 		log.debug(`user ${data.name} ${room ?? ''} event: ${event}`);
 	});
 
@@ -121,6 +234,9 @@ async function postAuthentication(socket: Socket) {
 			const socketsInRoom = await io.in(room).fetchSockets();
 			const socketsData = socketsInRoom.map((s) => s.data as IPlayerData);
 			socket.emit('data_update', socketsData);
+			// only changes get flushed, so catch the new player up on everyone's current state
+			const states = Object.values(ROOMS[room] ?? {}).map((s) => s.state);
+			if (states.length > 0) socket.emit('state_update', Buffer.concat(states));
 			log.info(`room ${room} update: ${JSON.stringify(socketsData)} users`);
 		}
 	});
@@ -131,6 +247,8 @@ async function postAuthentication(socket: Socket) {
 		// tell everyone we left
 		io.in(room).emit('left', data.id);
 		socket.leave(room);
+		dropState(room, data.id);
+		delete INTEREST[socket.id];
 		log.info(`room ${room} update: ${playerCount(parseInt(room))} users`);
 		room = undefined;
 	});
@@ -144,13 +262,42 @@ async function postAuthentication(socket: Socket) {
 		socket.to(room).emit('data_update', [data]);
 	});
 
-	socket.on('state_update', async (state: IPlayerState) => {
+	socket.on('state_update', async (update: unknown) => {
 		if (!room) return;
+		if (!Buffer.isBuffer(update)) return;
 		if (ROOMS[room] == undefined) ROOMS[room] = {};
-		if (!isValidState(state)) return;
-		state.id = data.id;
-		ROOMS[room][state.id] = state;
-		// socket.to(room).emit('state_update', [state]);
+		if (DIRTY[room] == undefined) DIRTY[room] = new Set();
+		const stored = ROOMS[room][data.id];
+		const next = applyStateUpdate(stored, update);
+		if (next == undefined) {
+			socket.emit('state_resync');
+			return;
+		}
+		if (next === stored) return;
+		// never trust the id the client sent
+		next.state.writeInt32LE(data.id, STATE_ID_OFFSET);
+		ROOMS[room][data.id] = next;
+		DIRTY[room].add(data.id);
+	});
+
+	socket.on('interest', async (hint: { x?: unknown; y?: unknown; max?: unknown }) => {
+		if (!room) return;
+		const { x, y, max } = hint ?? {};
+		if (typeof x != 'number' || typeof y != 'number' || typeof max != 'number') return;
+		if (!isFinite(x) || !isFinite(y)) return;
+		INTEREST[socket.id] = {
+			x,
+			y,
+			max: Math.min(Math.max(Math.floor(max), 1), MP_MAX_INTEREST),
+			pending: INTEREST[socket.id]?.pending ?? new Set(),
+		};
+	});
+
+	// clock sync, the client works out its offset from our clock from when we got & answered its request
+	socket.on('clock_sync', (sent: unknown) => {
+		const received = Date.now();
+		if (typeof sent != 'number') return;
+		socket.emit('clock_sync', { sent, received, replied: Date.now() });
 	});
 
 	// chat
@@ -168,8 +315,10 @@ async function postAuthentication(socket: Socket) {
 		if (room != undefined) {
 			io.in(room).emit('left', data.id);
 			socket.leave(room);
+			dropState(room, data.id);
 			room = undefined;
 		}
+		delete INTEREST[socket.id];
 		log.info(`user ${data.name} disconnected`);
 	});
 }
@@ -228,12 +377,31 @@ export function configure(server: http.Server | https.Server) {
 	});
 
 	// state update interval
+	let flushes = 0;
 	setInterval(() => {
-		for (const [roomId, room] of Object.entries(ROOMS)) {
-			if (Object.values(room).length == 0) {
-				continue;
+		const far = ++flushes % MP_FAR_FLUSH_EVERY == 0;
+		for (const [roomId, dirty] of Object.entries(DIRTY)) {
+			if (dirty.size == 0 && !far) continue;
+			// sent as one binary blob of changed states back to back
+			const everyone =
+				dirty.size > 0
+					? Buffer.concat([...dirty].map((id) => ROOMS[roomId][id].state))
+					: undefined;
+			let positions: IRoomPositions | undefined = undefined;
+			const getPositions = () => (positions ??= roomPositions(roomId));
+			for (const socketId of io.sockets.adapter.rooms.get(roomId) ?? []) {
+				const interest = INTEREST[socketId];
+				if (interest == undefined) {
+					// hasn't said what it cares about, it gets everything
+					if (everyone) io.to(socketId).emit('state_update', everyone);
+					continue;
+				}
+				for (const id of dirty) interest.pending.add(id);
+				const self = (io.sockets.sockets.get(socketId)?.data as IPlayerData | undefined)?.id ?? -1;
+				const states = takeInterestingStates(roomId, self, interest, far, getPositions);
+				if (states.length > 0) io.to(socketId).emit('state_update', Buffer.concat(states));
 			}
-			io.in(roomId).emit('state_update', Object.values(room));
+			dirty.clear();
 		}
 	}, MP_FLUSH_INTERVAL_MS);
 }
@@ -1,2 +1,15 @@
 export const PASSWORD_RESET_EXP_MINUTES = 10;
 export const MP_FLUSH_INTERVAL_MS = 50;
+// binary player state layout, must match multiplayer::player_state in the game
+export const MP_STATE_VERSION = 1;
+export const MP_STATE_SIZE = 39;
+export const MP_STATE_MASK_SIZE = Math.ceil(MP_STATE_SIZE / 8);
+// fixed point x & y position (i32 / MP_POS_SCALE) in the packed state
+export const MP_STATE_POS_OFFSET = 13;
+export const MP_POS_SCALE = 4096;
+// players outside a client's nearest few are only flushed to it this many flushes apart
+export const MP_FAR_FLUSH_EVERY = 10;
+export const MP_MAX_INTEREST = 64;
+export const MAX_BATCH_IDS = 100;
+// a client's downloads of a level only count once per window
+export const DOWNLOAD_PING_WINDOW_MS = 10 * 60 * 1000;
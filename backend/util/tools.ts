@@ -9,6 +9,7 @@ import { ILevelResponse } from '@/controllers/Level';
 import { IReplayResponse } from '@/controllers/Replay';
 import { ICommentResponse } from '@/controllers/Comment';
 import crypto from 'crypto';
+import zlib from 'zlib';
 
 import * as multiplayer from '@/multiplayer';
 
@@ -129,6 +130,40 @@ export function checkAuth() {
 	};
 }
 
+// gzips response bodies over the threshold (in bytes) for clients that accept it
+export function compressResponses(threshold = 1024) {
+	return (req: Request, res: Response, next: NextFunction) => {
+		if (!/\bgzip\b/.test(req.headers['accept-encoding'] ?? '')) return next();
+		const send = res.send.bind(res);
+		// res.json() stringifies and calls back into res.send(), so this catches both
+		res.send = (body?: any) => {
+			if (
+				(typeof body !== 'string' && !Buffer.isBuffer(body)) ||
+				Buffer.byteLength(body) < threshold ||
+				res.getHeader('Content-Encoding')
+			) {
+				return send(body);
+			}
+			if (!res.getHeader('Content-Type')) {
+				res.type(typeof body === 'string' ? 'html' : 'bin');
+			}
+			res.setHeader('Content-Encoding', 'gzip');
+			res.vary('Accept-Encoding');
+			return send(zlib.gzipSync(body));
+		};
+		next();
+	};
+}
+
+// reads the distinct integer ids out of a batch request body, or undefined if malformed
+export function batchIds(body: any, max: number): number[] | undefined {
+	const ids: unknown = body?.ids;
+	if (!Array.isArray(ids) || ids.length > max || !ids.every((id) => Number.isInteger(id))) {
+		return undefined;
+	}
+	return [...new Set<number>(ids)];
+}
+
 export interface IReplayHeader {
 	version: string;
 	levelId: number;
@@ -238,12 +273,12 @@ export function toCommentResponse(comment: UserLevelCommentPoster): ICommentResp
 	};
 }
 
-export function toReplayResponse(replay: UserLevelScoreRunner): IReplayResponse {
+export function toReplayResponse(replay: UserLevelScoreRunner, withRaw = true): IReplayResponse {
 	return {
 		id: replay.id,
 		user: toUserStub(replay.user),
 		levelId: replay.levelId,
-		raw: replay.replay.toString('base64'),
+		raw: withRaw ? replay.replay.toString('base64') : '',
 		time: replay.time,
 		version: replay.version,
 		createdAt: replay.createdAt.getTime() / 1000,
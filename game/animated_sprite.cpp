@@ -1,5 +1,7 @@
 #include "animated_sprite.hpp"
 
+#include <algorithm>
+
 animated_sprite::animated_sprite(sf::Texture& tex, int tx, int ty)
 	: m_tex(tex),
 	  m_tx(tx),
@@ -62,9 +64,11 @@ void animated_sprite::animate() {
 void animated_sprite::m_update_sprite_rect() {
 	// current frame index to use
 	int cfi = m_anims[m_current_animation][m_cframe];
+	// frames per row, an unloaded texture has no size
+	int cols = std::max(1, int(m_tex.getSize().x) / m_tx);
 	// current frame x and y pos in the texture
-	int cf_x = cfi % (m_tex.getSize().x / m_tx);
-	int cf_y = cfi / (m_tex.getSize().x / m_tx);
+	int cf_x = cfi % cols;
+	int cf_y = cfi / cols;
 
 	m_spr.setTextureRect(sf::IntRect(
 		cf_x * m_tx,
@@ -78,6 +82,10 @@ void animated_sprite::draw(sf::RenderTarget& t, sf::RenderStates s) const {
 	t.draw(m_spr, s);
 }
 
+const sf::Sprite& animated_sprite::spr() const {
+	return m_spr;
+}
+
 sf::Sprite& animated_sprite::spr() {
 	return m_spr;
 }
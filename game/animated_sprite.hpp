@@ -26,6 +26,7 @@ public:
 	sf::Vector2i size() const;	 // get the sprite's size
 
 	sf::Sprite& spr();	 // get the internal sprite
+	const sf::Sprite& spr() const;
 
 protected:
 	virtual void draw(sf::RenderTarget&, sf::RenderStates) const;
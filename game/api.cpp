@@ -3,22 +3,45 @@
 #include "auth.hpp"
 #include "context.hpp"
 #include "debug.hpp"
+#include "io_pool.hpp"
+#include "json_stream.hpp"
 #include "level.hpp"
 #include "replay.hpp"
 #include "settings.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <unordered_map>
 
 #define STRINGIFY(s) #s
 #define QUOTE(s) STRINGIFY(s)
 
+// the following move the big strings (level codes, replay data) out of parsed json instead of copying them
+static api::level take_level(nlohmann::json &&j) {
+	std::string code;
+	if (j.contains("code")) {
+		code = std::move(j["code"].get_ref<std::string &>());
+		j.erase("code");
+	}
+	api::level l = j.get<api::level>();
+	l.code		 = std::move(code);
+	return l;
+}
+
+static api::replay take_replay(nlohmann::json &&j) {
+	std::string raw;
+	if (j.contains("raw")) {
+		raw = std::move(j["raw"].get_ref<std::string &>());
+		j.erase("raw");
+	}
+	api::replay r = j.get<api::replay>();
+	r.raw		  = std::move(raw);
+	return r;
+}
+
 api::api()
-	: m_cli(settings::get().server_url()),
-	  m_gh_cli("https://api.github.com") {
-#ifdef NO_VERIFY_CERTS
-	m_cli.enable_server_certificate_verification(false);
-	m_gh_cli.enable_server_certificate_verification(false);
-#endif
+	: m_cache("cache/responses", CACHE_CAPACITY),
+	  m_batch_standin(batch_standin::from_env()) {
 }
 
 api &api::get() {
@@ -26,12 +49,25 @@ api &api::get() {
 	return instance;
 }
 
-std::future<api::multiplayer_token_response> api::fetch_multiplayer_token() {
-	return std::async([this]() -> api::multiplayer_token_response {
+httplib::Client &api::m_cli() {
+	return io_pool::client(settings::get().server_url());
+}
+
+httplib::Client &api::m_batch_cli() {
+	if (m_batch_standin) return io_pool::client(m_batch_standin->url());
+	return m_cli();
+}
+
+httplib::Client &api::m_gh_cli() {
+	return io_pool::client("https://api.github.com");
+}
+
+io_future<api::multiplayer_token_response> api::fetch_multiplayer_token() {
+	return io_pool::get().submit(io_pool::USER, [this]() -> api::multiplayer_token_response {
 		try {
 			nlohmann::json body = nlohmann::json::object();
 			auth::get().add_jwt_to_body(body);
-			if (auto res = m_cli.Post("/multiplayer-token", body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/multiplayer-token", body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					return { .success = true, .token = result["token"].get<std::string>() };
@@ -66,8 +102,8 @@ std::future<api::multiplayer_token_response> api::fetch_multiplayer_token() {
 	});
 }
 
-std::future<api::response> api::pin_level(int id) {
-	return std::async([this, id]() -> api::response {
+io_future<api::response> api::pin_level(int id) {
+	return io_pool::get().submit(io_pool::USER, [this, id]() -> api::response {
 		try {
 			nlohmann::json body = nlohmann::json::object();
 			auth::get().add_jwt_to_body(body);
@@ -77,8 +113,9 @@ std::future<api::response> api::pin_level(int id) {
 			} else {
 				uri += std::to_string(id) + "/pin";
 			}
-			if (auto res = m_cli.Post(uri, body.dump(), "application/json")) {
+			if (auto res = m_cli().Post(uri, body.dump(), "application/json")) {
 				if (res->status == 200) {
+					m_cache.invalidate("/users/");
 					return { .success = true };
 				} else {
 					nlohmann::json result = nlohmann::json::parse(res->body);
@@ -112,13 +149,15 @@ std::future<api::response> api::pin_level(int id) {
 	});
 }
 
-std::future<api::response> api::set_replay_visibility(int rid, bool visible) {
-	return std::async([this, rid, visible]() -> api::response {
+io_future<api::response> api::set_replay_visibility(int rid, bool visible) {
+	return io_pool::get().submit(io_pool::USER, [this, rid, visible]() -> api::response {
 		try {
 			nlohmann::json body = nlohmann::json::object();
 			auth::get().add_jwt_to_body(body);
-			if (auto res = m_cli.Post("/replay/" + std::to_string(rid) + (visible ? "/unhide" : "/hide"), body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/replay/" + std::to_string(rid) + (visible ? "/unhide" : "/hide"), body.dump(), "application/json")) {
 				if (res->status == 200) {
+					m_cache.invalidate("/replay/search/");
+					m_cache.invalidate("/users/");
 					return { .success = true };
 				} else {
 					nlohmann::json result = nlohmann::json::parse(res->body);
@@ -152,15 +191,17 @@ std::future<api::response> api::set_replay_visibility(int rid, bool visible) {
 	});
 }
 
-std::future<api::response> api::set_color(sf::Color fill, sf::Color outline) {
-	return std::async([this, fill, outline]() -> api::response {
+io_future<api::response> api::set_color(sf::Color fill, sf::Color outline) {
+	return io_pool::get().submit(io_pool::USER, [this, fill, outline]() -> api::response {
 		try {
 			nlohmann::json body = nlohmann::json::object();
 			auth::get().add_jwt_to_body(body);
 			body["fill"]	= fill.toInteger();
 			body["outline"] = outline.toInteger();
-			if (auto res = m_cli.Post("/set-player-color", body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/set-player-color", body.dump(), "application/json")) {
 				if (res->status == 200) {
+					m_cache.invalidate("/users/");
+					m_cache.invalidate("/level/");
 					return { .success = true };
 				} else {
 					nlohmann::json result = nlohmann::json::parse(res->body);
@@ -194,105 +235,74 @@ std::future<api::response> api::set_color(sf::Color fill, sf::Color outline) {
 	});
 }
 
-std::future<api::user_stats_response> api::fetch_user_stats(int id) {
-	return std::async([this, id]() -> api::user_stats_response {
-		try {
-			nlohmann::json body = nlohmann::json::object();
-			auth::get().add_jwt_to_body(body);
-			if (auto res = m_cli.Post("/users/" + std::to_string(id), body.dump(), "application/json")) {
-				nlohmann::json result = nlohmann::json::parse(res->body);
-				if (res->status == 200) {
-					user_stats_response rsp;
-					rsp.success = true;
-					rsp.stats	= result.get<user_stats>();
-					return rsp;
-				} else {
-					if (result.contains("error")) {
-						throw std::runtime_error(result["error"]);
-					} else {
-						throw "Unknown server error";
-					}
-				}
-			} else {
-				debug::log() << httplib::to_string(res.error()) << "\n";
-				throw "Could not connect to server";
-			}
-		} catch (const char *e) {
-			return {
-				.success = false,
-				.error	 = e
-			};
-		} catch (std::exception &e) {
-			return {
-				.success = false,
-				.error	 = e.what()
-			};
-		} catch (...) {
-			return {
-				.success = false,
-				.error	 = "Unknown error."
-			};
-		}
+io_future<api::user_stats_response> api::fetch_user_stats(int id) {
+	return io_pool::get().submit(io_pool::USER, io_pool::make_token(), [this, id]() -> api::user_stats_response {
+		return m_fetch_user_stats("/users/" + std::to_string(id));
 	});
 }
 
-std::future<api::user_stats_response> api::fetch_user_stats(std::string name) {
-	return std::async([this, name]() -> api::user_stats_response {
-		try {
-			nlohmann::json body = nlohmann::json::object();
-			auth::get().add_jwt_to_body(body);
-			if (auto res = m_cli.Post("/users/name/" + name, body.dump(), "application/json")) {
-				nlohmann::json result = nlohmann::json::parse(res->body);
-				if (res->status == 200) {
-					user_stats_response rsp;
-					rsp.success = true;
-					rsp.stats	= result.get<user_stats>();
-					return rsp;
+io_future<api::user_stats_response> api::fetch_user_stats(std::string name) {
+	return io_pool::get().submit(io_pool::USER, io_pool::make_token(), [this, name]() -> api::user_stats_response {
+		return m_fetch_user_stats("/users/name/" + name);
+	});
+}
+
+api::user_stats_response api::m_fetch_user_stats(const std::string &path) {
+	try {
+		nlohmann::json body = nlohmann::json::object();
+		auth::get().add_jwt_to_body(body);
+		if (auto res = m_cached_post(path, body.dump())) {
+			nlohmann::json result = nlohmann::json::parse(res->body);
+			if (res->status == 200) {
+				user_stats_response rsp;
+				rsp.success = true;
+				rsp.stats	= result.get<user_stats>();
+				return rsp;
+			} else {
+				if (result.contains("error")) {
+					throw std::runtime_error(result["error"]);
 				} else {
-					if (result.contains("error")) {
-						throw std::runtime_error(result["error"]);
-					} else {
-						throw "Unknown server error";
-					}
+					throw "Unknown server error";
 				}
-			} else {
-				debug::log() << httplib::to_string(res.error()) << "\n";
-				throw "Could not connect to server";
 			}
-		} catch (const char *e) {
-			return {
-				.success = false,
-				.error	 = e
-			};
-		} catch (std::exception &e) {
-			return {
-				.success = false,
-				.error	 = e.what()
-			};
-		} catch (...) {
-			return {
-				.success = false,
-				.error	 = "Unknown error."
-			};
+		} else {
+			throw "Could not connect to server";
 		}
-	});
+	} catch (const char *e) {
+		return {
+			.success = false,
+			.error	 = e
+		};
+	} catch (std::exception &e) {
+		return {
+			.success = false,
+			.error	 = e.what()
+		};
+	} catch (...) {
+		return {
+			.success = false,
+			.error	 = "Unknown error."
+		};
+	}
 }
 
-std::future<api::level_search_response> api::search_levels(api::level_search_query q) {
-	return std::async([this, q]() -> api::level_search_response {
+io_future<api::level_search_response> api::search_levels(api::level_search_query q, io_pool::priority p) {
+	return io_pool::get().submit(p, io_pool::make_token(), [this, q]() -> api::level_search_response {
 		try {
 			nlohmann::json body = q;
 			body["limit"]		= q.rows * q.cols;
 			auth::get().add_jwt_to_body(body);
-			if (auto res = m_cli.Post("/level/search", body.dump(), "application/json")) {
-				nlohmann::json result = nlohmann::json::parse(res->body);
+			if (auto res = m_cached_post("/level/search", body.dump())) {
+				// levels are converted as they're parsed, rather than after parsing the whole response
+				level_search_response rsp;
+				json_array_stream stream("levels", [&rsp](nlohmann::json &&level_json) {
+					rsp.levels.push_back(take_level(std::move(level_json)));
+				});
+				if (!stream.parse(res->body)) throw "Malformed server response";
+				nlohmann::json &result = stream.rest();
 				if (res->status == 200) {
-					level_search_response rsp;
 					rsp.cursor	= result["cursor"].get<int>();
 					rsp.success = true;
-					for (auto &level_json : result["levels"]) {
-						rsp.levels.push_back(level_json.get<api::level>());
-					}
 					return rsp;
 				} else {
 					if (result.contains("error")) {
@@ -302,7 +312,6 @@ std::future<api::level_search_response> api::search_levels(api::level_search_que
 					}
 				}
 			} else {
-				debug::log() << httplib::to_string(res.error()) << "\n";
 				throw "Could not connect to server";
 			}
 		} catch (const char *e) {
@@ -324,16 +333,17 @@ std::future<api::level_search_response> api::search_levels(api::level_search_que
 	});
 }
 
-std::future<api::comment_response> api::post_comment(int levelId, std::string comment) {
-	return std::async([this, levelId, comment]() -> api::comment_response {
+io_future<api::comment_response> api::post_comment(int levelId, std::string comment) {
+	return io_pool::get().submit(io_pool::USER, [this, levelId, comment]() -> api::comment_response {
 		try {
 			nlohmann::json body;
 			body["comment"] = comment;
 			auth::get().add_jwt_to_body(body);
 
-			if (auto res = m_cli.Post("/comments/new/" + std::to_string(levelId), body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/comments/new/" + std::to_string(levelId), body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
+					m_cache.invalidate("/comments/level/" + std::to_string(levelId));
 					comment_response rsp;
 					rsp.success = true;
 					rsp.code	= res->status;
@@ -368,17 +378,20 @@ std::future<api::comment_response> api::post_comment(int levelId, std::string co
 	});
 }
 
-std::future<api::replay_upload_response> api::upload_replay(::replay rp) {
-	return std::async([this, rp]() -> api::replay_upload_response {
+io_future<api::replay_upload_response> api::upload_replay(::replay rp) {
+	return io_pool::get().submit(io_pool::USER, [this, rp]() -> api::replay_upload_response {
 		try {
 			nlohmann::json body;
 			body["replay"] = rp.serialize_b64();
 			if (!debug::get().ndebug()) rp.save_to_file("misc/last_posted.rpl");
 			auth::get().add_jwt_to_body(body);
 
-			if (auto res = m_cli.Post("/replay/upload", body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/replay/upload", body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
+					m_cache.invalidate("/replay/search/");
+					m_cache.invalidate("/users/");
+					m_cache.invalidate("/level/");
 					replay_upload_response rsp;
 					rsp.success = true;
 					if (result.contains("newBest"))
@@ -413,13 +426,13 @@ std::future<api::replay_upload_response> api::upload_replay(::replay rp) {
 	});
 }
 
-std::future<api::comment_search_response> api::get_comments(int levelId, api::comment_search_query q) {
-	return std::async([this, q, levelId]() -> api::comment_search_response {
+io_future<api::comment_search_response> api::get_comments(int levelId, api::comment_search_query q) {
+	return io_pool::get().submit(io_pool::USER, io_pool::make_token(), [this, q, levelId]() -> api::comment_search_response {
 		try {
 			nlohmann::json body = q;
 			auth::get().add_jwt_to_body(body);
 
-			if (auto res = m_cli.Post("/comments/level/" + std::to_string(levelId), body.dump(), "application/json")) {
+			if (auto res = m_cached_post("/comments/level/" + std::to_string(levelId), body.dump())) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					comment_search_response rsp;
@@ -458,21 +471,22 @@ std::future<api::comment_search_response> api::get_comments(int levelId, api::co
 	});
 }
 
-std::future<api::replay_search_response> api::search_replays(int levelId, api::replay_search_query q) {
-	return std::async([this, q, levelId]() -> api::replay_search_response {
+io_future<api::replay_search_response> api::search_replays(int levelId, api::replay_search_query q) {
+	return io_pool::get().submit(io_pool::USER, io_pool::make_token(), [this, q, levelId]() -> api::replay_search_response {
 		try {
 			nlohmann::json body = q;
 			auth::get().add_jwt_to_body(body);
 
-			if (auto res = m_cli.Post("/replay/search/" + std::to_string(levelId), body.dump(), "application/json")) {
-				nlohmann::json result = nlohmann::json::parse(res->body);
+			if (auto res = m_cached_post("/replay/search/" + std::to_string(levelId), body.dump())) {
+				replay_search_response rsp;
+				json_array_stream stream("scores", [&rsp](nlohmann::json &&replay_json) {
+					rsp.scores.push_back(take_replay(std::move(replay_json)));
+				});
+				if (!stream.parse(res->body)) throw "Malformed server response";
+				nlohmann::json &result = stream.rest();
 				if (res->status == 200) {
-					replay_search_response rsp;
 					rsp.cursor	= result["cursor"].get<int>();
 					rsp.success = true;
-					for (auto &replay_json : result["scores"]) {
-						rsp.scores.push_back(replay_json.get<api::replay>());
-					}
 					return rsp;
 				} else {
 					if (result.contains("error")) {
@@ -504,22 +518,91 @@ std::future<api::replay_search_response> api::search_replays(int levelId, api::r
 }
 
 void api::ping_download(int id) {
-	std::thread([this, id]() -> void {
+	std::lock_guard<std::mutex> guard(m_ping_mutex);
+	m_pending_pings.push_back(id);
+	// pings that arrive before the queued flush runs go out with it
+	if (m_pending_pings.size() > 1) return;
+	io_pool::get().submit(io_pool::BACKGROUND, [this]() -> void {
+		std::vector<int> ids;
+		{
+			std::lock_guard<std::mutex> guard(m_ping_mutex);
+			std::swap(ids, m_pending_pings);
+		}
+		// the server counts each id once, and takes at most MAX_BATCH_IDS per request
+		std::sort(ids.begin(), ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+		for (std::size_t i = 0; i < ids.size(); i += MAX_BATCH_IDS) {
+			nlohmann::json body;
+			body["ids"] = std::vector<int>(ids.begin() + i, ids.begin() + std::min(i + MAX_BATCH_IDS, ids.size()));
+			auth::get().add_jwt_to_body(body);
+			try {
+				m_cli().Post("/level/ping-downloads", body.dump(), "application/json");
+			} catch (...) {
+			}
+		}
+	});
+}
+
+std::string api::m_cache_key(const std::string &body) {
+	// the token changes every refresh, but the responses only depend on who it's for
+	nlohmann::json key = nlohmann::json::parse(body, nullptr, false);
+	if (key.is_discarded() || !key.is_object()) return body;
+	key.erase("jwt");
+	key["as"] = auth::get().id();
+	return key.dump();
+}
+
+std::optional<api::cached_response> api::m_cached_post(const std::string &path, const std::string &body) {
+	std::string key = m_cache_key(body);
+	if (auto hit = m_cache.get(path, key)) {
+		std::time_t age = std::time(nullptr) - hit->stored;
+		if (age < CACHE_STALE_FOR) {
+			// serve what we have, and bring it up to date for next time
+			if (age >= CACHE_FRESH_FOR) m_revalidate(path, body, key);
+			return cached_response{ .status = 200, .body = std::move(hit->body) };
+		}
+	}
+	return m_fetch_and_cache(path, body, key);
+}
+
+std::optional<api::cached_response> api::m_fetch_and_cache(const std::string &path, const std::string &body, const std::string &key) {
+	auto res = m_cli().Post(path, body, "application/json");
+	if (!res) {
+		// a cancelled request fails with its connection shut down under it
+		if (!io_pool::cancelled()) debug::log() << httplib::to_string(res.error()) << "\n";
+		return {};
+	}
+	if (res->status == 200) {
+		m_cache.put(path, key, res->body);
+	}
+	return cached_response{ .status = res->status, .body = std::move(res->body) };
+}
+
+void api::m_revalidate(const std::string &path, const std::string &body, const std::string &key) {
+	{
+		// one revalidation per request at a time
+		std::lock_guard<std::mutex> guard(m_revalidating_mutex);
+		if (!m_revalidating.insert(path + "\n" + key).second) return;
+	}
+	io_pool::get().submit(io_pool::BACKGROUND, [this, path, body, key]() -> void {
 		try {
-			std::string path = "/level/" + std::to_string(id) + "/ping-download";
-			m_cli.Get(path);
+			m_fetch_and_cache(path, body, key);
 		} catch (...) {
 		}
-	}).detach();
+		std::lock_guard<std::mutex> guard(m_revalidating_mutex);
+		m_revalidating.erase(path + "\n" + key);
+	});
 }
 
-std::future<api::level_response> api::download_level(int id) {
-	return std::async([this, id]() -> api::level_response {
+io_future<api::level_response> api::download_level(int id) {
+	return io_pool::get().submit(io_pool::USER, io_pool::make_token(), [this, id]() -> api::level_response {
 		try {
+			// never cached. this is the request that counts the download, and a replay has to be recorded
+			// against the level as it is right now to be accepted
 			std::string path = "/level/" + std::to_string(id);
 			nlohmann::json body;
 			auth::get().add_jwt_to_body(body);
-			if (auto res = m_cli.Post(path, body.dump(), "application/json")) {
+			if (auto res = m_cli().Post(path, body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					return {
@@ -565,10 +648,85 @@ std::future<api::level_response> api::download_level(int id) {
 	});
 }
 
-std::future<api::level_response> api::quickplay_level() {
-	return std::async([this]() -> api::level_response {
+io_future<api::replays_response> api::fetch_replays(std::span<const int> ids) {
+	auto promise = std::make_shared<std::promise<replays_response>>();
+	std::vector<int> wanted(ids.begin(), ids.end());
+	std::lock_guard<std::mutex> guard(m_batch_mutex);
+	m_replay_batch.ids.insert(m_replay_batch.ids.end(), wanted.begin(), wanted.end());
+	m_replay_batch.callbacks.push_back([promise, wanted](const nlohmann::json &result, const std::optional<std::string> &error) {
+		if (error) {
+			promise->set_value({ .success = false, .error = error });
+			return;
+		}
+		std::unordered_map<int, const nlohmann::json *> by_id;
+		for (auto &replay_json : result["replays"]) {
+			by_id[replay_json["id"].get<int>()] = &replay_json;
+		}
+		replays_response rsp{ .success = true };
+		for (int id : wanted) {
+			if (by_id.contains(id)) rsp.replays.push_back(by_id[id]->get<api::replay>());
+		}
+		promise->set_value(rsp);
+	});
+	return io_future<replays_response>(promise->get_future(), nullptr);
+}
+
+void api::flush_batches() {
+	batch replays;
+	{
+		std::lock_guard<std::mutex> guard(m_batch_mutex);
+		std::swap(replays, m_replay_batch);
+	}
+	if (!replays.callbacks.empty()) m_flush_batch("/replay/batch", std::move(replays));
+}
+
+void api::m_flush_batch(const std::string &path, batch b) {
+	io_pool::get().submit(io_pool::USER, [this, path, b = std::move(b)]() -> void {
+		nlohmann::json result = nlohmann::json::object();
+		std::optional<std::string> error;
+		try {
+			// the server takes each id once, and at most MAX_BATCH_IDS per request
+			std::vector<int> ids = b.ids;
+			std::sort(ids.begin(), ids.end());
+			ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+			for (std::size_t i = 0; i < ids.size() && !error; i += MAX_BATCH_IDS) {
+				nlohmann::json body;
+				body["ids"] = std::vector<int>(ids.begin() + i, ids.begin() + std::min(i + MAX_BATCH_IDS, ids.size()));
+				auth::get().add_jwt_to_body(body);
+				if (auto res = m_batch_cli().Post(path, body.dump(), "application/json")) {
+					nlohmann::json chunk = nlohmann::json::parse(res->body);
+					if (res->status != 200) {
+						error = chunk.contains("error") ? chunk["error"].get<std::string>() : "Unknown server error";
+						break;
+					}
+					for (auto &[key, items] : chunk.items()) {
+						for (auto &item : items) {
+							result[key].push_back(item);
+						}
+					}
+				} else {
+					error = "Could not connect to server";
+				}
+			}
+		} catch (std::exception &e) {
+			error = e.what();
+		} catch (...) {
+			error = "Unknown error.";
+		}
+		for (auto &callback : b.callbacks) {
+			try {
+				callback(result, error);
+			} catch (std::exception &e) {
+				callback(result, e.what());
+			}
+		}
+	});
+}
+
+io_future<api::level_response> api::quickplay_level() {
+	return io_pool::get().submit(io_pool::USER, io_pool::make_token(), [this]() -> api::level_response {
 		try {
-			if (auto res = m_cli.Get("/level/quickplay")) {
+			if (auto res = m_cli().Get("/level/quickplay")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					return {
@@ -608,8 +766,8 @@ std::future<api::level_response> api::quickplay_level() {
 	});
 }
 
-std::future<api::level_response> api::upload_level(::level l, ::replay verify, const char *title, const char *description, bool override) {
-	return std::async([this, l, title, description, override, verify]() -> api::level_response {
+io_future<api::level_response> api::upload_level(::level l, ::replay verify, const char *title, const char *description, bool override) {
+	return io_pool::get().submit(io_pool::USER, [this, l, title, description, override, verify]() -> api::level_response {
 		if (!auth::get().authed()) {
 			return {
 				.success = false,
@@ -625,9 +783,11 @@ std::future<api::level_response> api::upload_level(::level l, ::replay verify, c
 			body["verification"] = verify.serialize_b64();
 			auth::get().add_jwt_to_body(body);
 			std::string path = override ? "/level/upload/confirm" : "/level/upload";
-			if (auto res = m_cli.Post(path, body.dump(), "application/json")) {
+			if (auto res = m_cli().Post(path, body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
+					m_cache.invalidate("/level/");
+					m_cache.invalidate("/users/");
 					nlohmann::json level = result["level"];
 					api::level l		 = level.get<api::level>();
 					return {
@@ -673,8 +833,8 @@ std::future<api::level_response> api::upload_level(::level l, ::replay verify, c
 	});
 }
 
-std::future<api::vote_response> api::vote_level(api::level lvl, api::vote v) {
-	return std::async([this, lvl, v]() -> api::vote_response {
+io_future<api::vote_response> api::vote_level(api::level lvl, api::vote v) {
+	return io_pool::get().submit(io_pool::USER, [this, lvl, v]() -> api::vote_response {
 		try {
 			std::string url = "/level/";
 			url += std::to_string(lvl.id);
@@ -682,9 +842,11 @@ std::future<api::vote_response> api::vote_level(api::level lvl, api::vote v) {
 			url += v == vote::LIKE ? "like" : "dislike";
 			nlohmann::json body = nlohmann::json::object();
 			auth::get().add_jwt_to_body(body);
-			if (auto res = m_cli.Post(url, body.dump(), "application/json")) {
+			if (auto res = m_cli().Post(url, body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
+					m_cache.invalidate("/level/");
+					m_cache.invalidate("/users/");
 					return {
 						.success = true,
 						.level	 = result["level"].get<api::level>(),
@@ -728,9 +890,9 @@ const char *api::version() const {
 #endif
 }
 
-std::future<api::update_response> api::is_up_to_date() {
+io_future<api::update_response> api::is_up_to_date() {
 #if !defined(NDEBUG)
-	return std::async([this]() -> api::update_response {
+	return io_pool::get().submit(io_pool::USER, io_pool::make_token(), [this]() -> api::update_response {
 		return {
 			.success		= true,
 			.up_to_date		= true,
@@ -739,9 +901,9 @@ std::future<api::update_response> api::is_up_to_date() {
 	});
 #endif
 	std::string ctag(version());
-	return std::async([this, ctag]() -> api::update_response {
+	return io_pool::get().submit(io_pool::USER, [this, ctag]() -> api::update_response {
 		try {
-			if (auto res = m_gh_cli.Get("/repos/sarahkittyy/blockquest-remake/releases/latest")) {
+			if (auto res = m_gh_cli().Get("/repos/sarahkittyy/blockquest-remake/releases/latest")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					return {
@@ -829,7 +991,8 @@ bool api::level_search_query::operator!=(const level_search_query &other) const
 bool api::replay_search_query::operator==(const replay_search_query &other) const {
 	return sortBy == other.sortBy &&
 		   order == other.order &&
-		   limit == other.limit;
+		   limit == other.limit &&
+		   raw == other.raw;
 }
 
 bool api::replay_search_query::operator!=(const replay_search_query &other) const {
@@ -837,15 +1000,16 @@ bool api::replay_search_query::operator!=(const replay_search_query &other) cons
 }
 
 void api::flush_colors() {
-	std::thread([this]() {
-		const int me = auth::get().id();
-		if (me == -1) return;
-		auto res = fetch_user_stats(me).get();
+	const int me = auth::get().id();
+	if (me == -1) return;
+	// fetched right on the pool thread, waiting on another pool job from one could starve the pool
+	io_pool::get().submit(io_pool::BACKGROUND, [this, me]() -> void {
+		auto res = m_fetch_user_stats("/users/" + std::to_string(me));
 		if (res.success) {
 			context::get().set_player_fill(sf::Color(res.stats->fillColor));
 			context::get().set_player_outline(sf::Color(res.stats->outlineColor));
 		}
-	}).detach();
+	});
 }
 
 void to_json(nlohmann::json &j, const api::user_stats &s) {
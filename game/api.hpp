@@ -3,10 +3,19 @@
 #include <SFML/Graphics.hpp>
 #include <ctime>
 #include <future>
+#include <mutex>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
+#include "batch_standin.hpp"
+#include "http_cache.hpp"
 #include "httplib.h"
+#include "io_pool.hpp"
 #include "json.hpp"
 
 class level;
@@ -126,6 +135,13 @@ public:
 		std::optional<api::level> level;
 	};
 
+	// replays found, in the order their ids were asked for. unknown or hidden ids are skipped
+	struct replays_response {
+		bool success;
+		std::optional<std::string> error;
+		std::vector<api::replay> replays;
+	};
+
 	struct multiplayer_token_response {
 		bool success;
 		std::optional<std::string> error;
@@ -181,10 +197,12 @@ public:
 		std::string sortBy = "time";
 		std::string order  = "asc";
 
+		bool raw = true;   // send each replay's data along, or leave it to be fetched when it's wanted
+
 		bool operator==(const replay_search_query& other) const;
 		bool operator!=(const replay_search_query& other) const;
 
-		NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(api::replay_search_query, cursor, limit, sortBy, order);
+		NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(api::replay_search_query, cursor, limit, sortBy, order, raw);
 	};
 
 	struct replay_search_response {
@@ -234,35 +252,38 @@ public:
 		OUTLINE,
 	};
 
-	std::future<level_response> upload_level(::level l, ::replay verify, const char* title, const char* description, bool override = false);
-	std::future<level_response> download_level(int id);
-	std::future<level_response> quickplay_level();
-	std::future<vote_response> vote_level(api::level lvl, vote v);
+	io_future<level_response> upload_level(::level l, ::replay verify, const char* title, const char* description, bool override = false);
+	io_future<level_response> download_level(int id);
+	// queues its ids, and all calls made in a frame go out as one request on flush_batches()
+	io_future<replays_response> fetch_replays(std::span<const int> ids);
+	void flush_batches();	// call once per frame
+	io_future<level_response> quickplay_level();
+	io_future<vote_response> vote_level(api::level lvl, vote v);
 
-	std::future<api::comment_response> post_comment(int levelId, std::string comment);
-	std::future<api::comment_search_response> get_comments(int levelId, api::comment_search_query q);
+	io_future<api::comment_response> post_comment(int levelId, std::string comment);
+	io_future<api::comment_search_response> get_comments(int levelId, api::comment_search_query q);
 
-	std::future<api::replay_search_response> search_replays(int levelId, api::replay_search_query q);
-	std::future<api::replay_upload_response> upload_replay(::replay rp);
+	io_future<api::replay_search_response> search_replays(int levelId, api::replay_search_query q);
+	io_future<api::replay_upload_response> upload_replay(::replay rp);
 
-	std::future<api::response> set_replay_visibility(int rid, bool visible);
+	io_future<api::response> set_replay_visibility(int rid, bool visible);
 
-	std::future<api::multiplayer_token_response> fetch_multiplayer_token();
+	io_future<api::multiplayer_token_response> fetch_multiplayer_token();
 
-	std::future<api::user_stats_response> fetch_user_stats(int id);
-	std::future<api::user_stats_response> fetch_user_stats(std::string name);
+	io_future<api::user_stats_response> fetch_user_stats(int id);
+	io_future<api::user_stats_response> fetch_user_stats(std::string name);
 
-	std::future<api::response> set_color(sf::Color fill, sf::Color outline);
+	io_future<api::response> set_color(sf::Color fill, sf::Color outline);
 	// if id = -1, will unpin the level
-	std::future<api::response> pin_level(int id = -1);
+	io_future<api::response> pin_level(int id = -1);
 
 	// get the current app version
 	const char* version() const;
 
 	// is this application up-to-date
-	std::future<update_response> is_up_to_date();
+	io_future<update_response> is_up_to_date();
 
-	std::future<level_search_response> search_levels(level_search_query q);
+	io_future<level_search_response> search_levels(level_search_query q, io_pool::priority p = io_pool::USER);
 
 	// sends a download ping to be run when we fetch a level
 	void ping_download(int id);
@@ -274,8 +295,49 @@ private:
 	api(const api& other) = delete;
 	api(api&& other)	  = delete;
 
-	httplib::Client m_cli;
-	httplib::Client m_gh_cli;
+	httplib::Client& m_cli();	   // this thread's connection to the server
+	httplib::Client& m_gh_cli();   // this thread's connection to github
+
+	// RESPONSE CACHE
+	static constexpr std::size_t CACHE_CAPACITY  = 512;
+	static constexpr std::time_t CACHE_FRESH_FOR = 30;				   // seconds a response is served without revalidating it
+	static constexpr std::time_t CACHE_STALE_FOR = 7 * 24 * 60 * 60;   // seconds a stale response is still served for
+	http_cache m_cache;
+
+	struct cached_response {
+		int status;
+		std::string body;
+	};
+	// posts to the server, serving the cached response if we have one & revalidating it in the background if stale.
+	// levels in cached responses may be older than the server's, so playing one means download_level() first
+	std::optional<cached_response> m_cached_post(const std::string& path, const std::string& body);
+	// posts to the server & caches the response under key. the api's routes are all POSTs, which never get a 304,
+	// so revalidating refetches the whole response
+	std::optional<cached_response> m_fetch_and_cache(const std::string& path, const std::string& body, const std::string& key);
+	void m_revalidate(const std::string& path, const std::string& body, const std::string& key);
+	static std::string m_cache_key(const std::string& body);   // the request body with the user's id in place of their token
+
+	user_stats_response m_fetch_user_stats(const std::string& path);   // the body of fetch_user_stats, on the calling thread
+
+	std::mutex m_revalidating_mutex;
+	std::unordered_set<std::string> m_revalidating;	  // requests being revalidated right now
+	// // // //
+
+	// a batch endpoint's pending request
+	struct batch {
+		std::vector<int> ids;	// every id asked for since the last flush
+		// hands each caller the parsed response, or the error if the request failed
+		std::vector<std::function<void(const nlohmann::json&, const std::optional<std::string>&)>> callbacks;
+	};
+	static constexpr std::size_t MAX_BATCH_IDS = 100;	// most ids the server takes in one batch request
+	std::mutex m_batch_mutex;
+	batch m_replay_batch;
+	void m_flush_batch(const std::string& path, batch b);
+	std::unique_ptr<batch_standin> m_batch_standin;	  // answers batch requests locally instead, see BQR_BATCH_STANDIN
+	httplib::Client& m_batch_cli();					  // this thread's connection to whoever answers batch requests
+
+	std::mutex m_ping_mutex;
+	std::vector<int> m_pending_pings;	// level ids downloaded, waiting to be sent in one batch
 };
 
 void to_json(nlohmann::json& j, const api::level& l);
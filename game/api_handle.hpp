@@ -4,6 +4,7 @@
 #include <optional>
 #include <stdexcept>
 
+#include "io_pool.hpp"
 #include "util.hpp"
 
 /// the status of an api call is either inactive, currently fetching, or has result
@@ -14,12 +15,38 @@ public:
 		: m_status() {
 	}
 
+	api_handle(api_handle&& other) = default;
+	// whatever this was fetching is cancelled, same as reset()
+	api_handle& operator=(api_handle&& other) {
+		if (this == &other) return *this;
+		m_cancel();
+		m_future = std::move(other.m_future);
+		m_status = std::move(other.m_status);
+		m_token	 = std::move(other.m_token);
+		return *this;
+	}
+
+	~api_handle() {
+		m_cancel();
+	}
+
+	// drops the current request without waiting on it, cancelling it if possible
 	void reset() {
-		if (m_future.valid()) m_future.get();
+		m_cancel();
+		m_future = {};
+		m_status.reset();
+	}
+
+	// replaces the current request, which is cancelled if still in flight
+	void reset(io_future<Body>&& fut) {
+		m_cancel();
 		m_status.reset();
+		m_token	 = fut.token();
+		m_future = std::move(fut);
 	}
 
 	void reset(std::future<Body>&& fut) {
+		m_cancel();
 		m_status.reset();
 		m_future = std::move(fut);
 	}
@@ -34,7 +61,12 @@ public:
 
 	void poll() {
 		if (!ready() && m_future.valid() && util::ready(m_future)) {
-			m_status = m_future.get();
+			try {
+				m_status = m_future.get();
+			} catch (const std::future_error&) {
+				// the request was cancelled before it ran
+			}
+			m_token.reset();
 		}
 	}
 
@@ -51,4 +83,10 @@ public:
 private:
 	std::future<Body> m_future;
 	std::optional<Body> m_status;
+	io_pool::cancel_token m_token;	 // cancels the request in flight, if it can be
+
+	void m_cancel() {
+		if (m_token && m_future.valid()) io_pool::get().cancel(m_token);
+		m_token.reset();
+	}
 };
@@ -18,6 +18,7 @@
 #include "states/search.hpp"
 
 #include "api.hpp"
+#include "io_pool.hpp"
 #include "multiplayer.hpp"
 #include "util.hpp"
 
@@ -83,12 +84,22 @@ int app::run() {
 		sf::Time dt = delta_clock.restart();
 		ImGui::SFML::Update(win, dt);
 		debug::get().flush();
+		io_pool::stats net = io_pool::get().get_stats();
+		debug::get() << "api: " << net.requests << " requests, "
+					 << (net.jobs ? net.busy.asMilliseconds() / net.jobs : 0) << "ms avg, "
+					 << net.wire_bytes / 1024 << "KiB received (" << net.body_bytes / 1024 << "KiB decompressed)\n";
+		multiplayer::net_stats mp = multiplayer::get().get_net_stats();
+		debug::get() << "mp: " << int(mp.sent_rate) << "B/s up, " << int(mp.recv_rate) << "B/s down, "
+					 << mp.sent_updates << " sent / " << mp.recv_updates << " received ("
+					 << mp.sent_bytes / 1024 << "KiB / " << mp.recv_bytes / 1024 << "KiB), "
+					 << mp.rtt << "ms rtt, clock " << mp.clock_offset << "ms off\n";
 		multiplayer::get().update();
 		m_fsm.update(dt);
 
 		// imgui rendering
 		m_fsm.imdraw();
 		debug::get().imdraw(dt);
+		api::get().flush_batches();
 
 		// versioning / update stuff
 		if (version_future.valid() && util::ready(version_future)) {
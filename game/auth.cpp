@@ -2,14 +2,11 @@
 
 #include "api.hpp"
 #include "debug.hpp"
+#include "io_pool.hpp"
 #include "settings.hpp"
 #include "util.hpp"
 
-auth::auth()
-	: m_cli(settings::get().server_url()) {
-#ifdef NO_VERIFY_CERTS
-	m_cli.enable_server_certificate_verification(false);
-#endif
+auth::auth() {
 }
 
 auth& auth::get() {
@@ -17,6 +14,10 @@ auth& auth::get() {
 	return instance;
 }
 
+httplib::Client& auth::m_cli() {
+	return io_pool::client(settings::get().server_url());
+}
+
 bool auth::authed(bool confirmed) const {
 	return m_jwt.has_value() && time(nullptr) < m_jwt->exp && (!confirmed || m_jwt->confirmed);
 }
@@ -43,16 +44,16 @@ void auth::add_jwt_to_body(nlohmann::json& body) {
 	}
 }
 
-std::future<auth::response> auth::signup(std::string email, std::string username, std::string password) {
+io_future<auth::response> auth::signup(std::string email, std::string username, std::string password) {
 	// clang-format off
 	using namespace std::chrono_literals;
-	return std::async([this, email, username, password]() -> auth::response {
+	return io_pool::get().submit(io_pool::USER, [this, email, username, password]() -> auth::response {
 		try {
 			nlohmann::json body;
 			body["name"] = username;
 			body["email"] = email;
 			body["password"] = password;
-			if (auto res = m_cli.Post("/signup", body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/signup", body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					std::string jwt = result["jwt"].get<std::string>();
@@ -112,16 +113,16 @@ std::future<auth::response> auth::signup(std::string email, std::string username
 	// clang-format on
 }
 
-std::future<auth::response> auth::login(std::string email_or_username, std::string password) {
+io_future<auth::response> auth::login(std::string email_or_username, std::string password) {
 	// clang-format off
 	using namespace std::chrono_literals;
-	return std::async([this, email_or_username, password]() -> auth::response {
+	return io_pool::get().submit(io_pool::USER, [this, email_or_username, password]() -> auth::response {
 		try {
 			std::string server_url = settings::get().server_url();
 			nlohmann::json body;
 			body["username"] = email_or_username;
 			body["password"] = password;
-			if (auto res = m_cli.Post("/login", body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/login", body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					std::string jwt = result["jwt"].get<std::string>();
@@ -181,14 +182,14 @@ std::future<auth::response> auth::login(std::string email_or_username, std::stri
 	// clang-format on
 }
 
-std::future<auth::forgot_password_response> auth::forgot_password(std::string email) {
+io_future<auth::forgot_password_response> auth::forgot_password(std::string email) {
 	// clang-format off
 	using namespace std::chrono_literals;
-	return std::async([this, email]() -> auth::forgot_password_response {
+	return io_pool::get().submit(io_pool::USER, [this, email]() -> auth::forgot_password_response {
 		try {
 			nlohmann::json body;
 			body["email"] = email;
-			if (auto res = m_cli.Post("/forgot-password", body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/forgot-password", body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					return {
@@ -226,16 +227,16 @@ std::future<auth::forgot_password_response> auth::forgot_password(std::string em
 	// clang-format on
 }
 
-std::future<auth::reset_password_response> auth::reset_password(std::string email, std::string code, std::string newPassword) {
+io_future<auth::reset_password_response> auth::reset_password(std::string email, std::string code, std::string newPassword) {
 	// clang-format off
 	using namespace std::chrono_literals;
-	return std::async([this, email, code, newPassword]() -> auth::reset_password_response {
+	return io_pool::get().submit(io_pool::USER, [this, email, code, newPassword]() -> auth::reset_password_response {
 		try {
 			nlohmann::json body;
 			body["email"] = email;
 			body["code"] = code;
 			body["password"] = newPassword;
-			if (auto res = m_cli.Post("/reset-password", body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/reset-password", body.dump(), "application/json")) {
 				if (res->status == 200) {
 					return {
 						.success = true,
@@ -271,10 +272,10 @@ std::future<auth::reset_password_response> auth::reset_password(std::string emai
 	// clang-format on
 }
 
-std::future<auth::response> auth::verify(int code) {
+io_future<auth::response> auth::verify(int code) {
 	// clang-format off
 	using namespace std::chrono_literals;
-	return std::async([this, code]() -> auth::response {
+	return io_pool::get().submit(io_pool::USER, [this, code]() -> auth::response {
 		try {
 			std::string url = "";
 			url += "/verify/";
@@ -283,7 +284,7 @@ std::future<auth::response> auth::verify(int code) {
 			if (m_jwt) {
 				body["jwt"] = m_jwt->raw;
 			}
-			if (auto res = m_cli.Post(url, body.dump(), "application/json")) {
+			if (auto res = m_cli().Post(url, body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					std::string jwt = result["jwt"].get<std::string>();
@@ -335,16 +336,16 @@ std::future<auth::response> auth::verify(int code) {
 	});
 	// clang-format on
 }
-std::future<auth::reverify_response> auth::resend_verify() {
+io_future<auth::reverify_response> auth::resend_verify() {
 	// clang-format off
 	using namespace std::chrono_literals;
-	return std::async([this]() -> auth::reverify_response {
+	return io_pool::get().submit(io_pool::USER, [this]() -> auth::reverify_response {
 		try {
 			nlohmann::json body;
 			if (m_jwt) {
 				body["jwt"] = m_jwt->raw;
 			}
-			if (auto res = m_cli.Post("/resend-verify", body.dump(), "application/json")) {
+			if (auto res = m_cli().Post("/resend-verify", body.dump(), "application/json")) {
 				nlohmann::json result = nlohmann::json::parse(res->body);
 				if (res->status == 200) {
 					return {
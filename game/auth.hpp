@@ -6,6 +6,7 @@
 #include <string>
 
 #include "httplib.h"
+#include "io_pool.hpp"
 #include "json.hpp"
 
 // singleton class that manages the authentication state of the user
@@ -49,15 +50,15 @@ public:
 		std::optional<std::string> error;
 	};
 
-	std::future<response> signup(std::string email, std::string username, std::string password);
-	std::future<response> login(std::string email_or_username, std::string password);
+	io_future<response> signup(std::string email, std::string username, std::string password);
+	io_future<response> login(std::string email_or_username, std::string password);
 	void logout();
 
-	std::future<forgot_password_response> forgot_password(std::string email);
-	std::future<reset_password_response> reset_password(std::string email, std::string code, std::string newPassword);
+	io_future<forgot_password_response> forgot_password(std::string email);
+	io_future<reset_password_response> reset_password(std::string email, std::string code, std::string newPassword);
 
-	std::future<response> verify(int code);
-	std::future<reverify_response> resend_verify();
+	io_future<response> verify(int code);
+	io_future<reverify_response> resend_verify();
 
 	std::string username() const;	// the current authed username
 	int id() const;					// the current authed user id, or -1
@@ -72,7 +73,7 @@ private:
 	auth(const auth& other) = delete;
 	auth(auth&& other)		= delete;
 
-	httplib::Client m_cli;
+	httplib::Client& m_cli();	 // this thread's connection to the server
 
 	std::optional<jwt> m_jwt;	// optional jwt we receive from logging in
 };
@@ -0,0 +1,86 @@
+#include "batch_standin.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <set>
+
+#include "debug.hpp"
+#include "json.hpp"
+
+std::unique_ptr<batch_standin> batch_standin::from_env() {
+	const char* dir = std::getenv("BQR_BATCH_STANDIN");
+	if (!dir) return nullptr;
+	return std::make_unique<batch_standin>(dir);
+}
+
+batch_standin::batch_standin(std::filesystem::path dir)
+	: m_dir(dir),
+	  m_port(-1),
+	  m_requests(0),
+	  m_ids(0) {
+	m_server.Post("/replay/batch", [this](const httplib::Request& req, httplib::Response& res) {
+		m_serve("replays", req, res);
+	});
+	m_port = m_server.bind_to_any_port("127.0.0.1");
+	if (m_port < 0) {
+		debug::log() << "batch stand-in could not bind a local port\n";
+		return;
+	}
+	m_thread = std::thread([this]() {
+		m_server.listen_after_bind();
+	});
+	debug::log() << "batch requests go to a stand-in serving " << m_dir.string() << " at " << url() << "\n";
+}
+
+batch_standin::~batch_standin() {
+	m_server.stop();
+	if (m_thread.joinable()) m_thread.join();
+}
+
+std::string batch_standin::url() const {
+	return "http://127.0.0.1:" + std::to_string(m_port);
+}
+
+void batch_standin::m_serve(const std::string& kind, const httplib::Request& req, httplib::Response& res) {
+	// the same checks as the server's tools.batchIds
+	nlohmann::json body = nlohmann::json::parse(req.body, nullptr, false);
+	std::set<int> ids;
+	bool valid = !body.is_discarded() && body.contains("ids") && body["ids"].is_array() && body["ids"].size() <= MAX_BATCH_IDS;
+	if (valid) {
+		for (auto& id : body["ids"]) {
+			if (!id.is_number_integer()) {
+				valid = false;
+				break;
+			}
+			ids.insert(id.get<int>());
+		}
+	}
+	if (!valid) {
+		nlohmann::json err = { { "error", "Expected an array of at most " + std::to_string(MAX_BATCH_IDS) + " ids" } };
+		res.status		   = 400;
+		res.set_content(err.dump(), "application/json");
+		return;
+	}
+
+	// unknown ids are skipped, and so are hidden replays, as nobody's logged in here
+	nlohmann::json items = nlohmann::json::array();
+	for (int id : ids) {
+		std::ifstream file(m_dir / kind / (std::to_string(id) + ".json"));
+		if (!file) continue;
+		nlohmann::json item = nlohmann::json::parse(file, nullptr, false);
+		if (item.is_discarded() || !item.is_object()) {
+			debug::log() << "batch stand-in skipping malformed " << kind << "/" << id << ".json\n";
+			continue;
+		}
+		if (item.value("hidden", false)) continue;
+		item["id"] = id;
+		items.push_back(item);
+	}
+
+	uint64_t requests = ++m_requests;
+	uint64_t asked	  = m_ids += ids.size();
+	debug::log() << "batch stand-in: " << ids.size() << " " << kind << " asked for, " << items.size() << " found ("
+				 << asked << " ids over " << requests << " requests so far)\n";
+	nlohmann::json out = { { kind, items } };
+	res.set_content(out.dump(), "application/json");
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "httplib.h"
+
+/// stands in for the server's batch endpoint, so batched replay fetches can be tried without the backend.
+/// answers POST /replay/batch on localhost the way the real server does, from json files in the api's
+/// format: <dir>/replays/<id>.json
+class batch_standin {
+public:
+	// started on a free local port if BQR_BATCH_STANDIN is set to a directory, otherwise null
+	static std::unique_ptr<batch_standin> from_env();
+
+	batch_standin(std::filesystem::path dir);
+	~batch_standin();
+
+	std::string url() const;   // where it's listening
+
+	static constexpr std::size_t MAX_BATCH_IDS = 100;	// same as the real server
+
+private:
+	std::filesystem::path m_dir;
+	httplib::Server m_server;
+	int m_port;
+	std::thread m_thread;
+	std::atomic<uint64_t> m_requests;	// batch requests answered, to see how well fetches are coalesced
+	std::atomic<uint64_t> m_ids;		// ids asked for across all of them
+
+	// answer a batch request for kind ("replays") from the files in its folder
+	void m_serve(const std::string& kind, const httplib::Request& req, httplib::Response& res);
+};
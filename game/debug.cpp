@@ -8,6 +8,8 @@
 #include "resource.hpp"
 #include "tilemap.hpp"
 
+thread_local bool debug::m_log_mode = false;
+
 debug& debug::get() {
 	static debug instance;
 	instance.m_log_mode = false;
@@ -18,7 +18,8 @@ public:
 	static debug& log();
 
 	bool ndebug() const {
-#ifdef NDEBUG
+#if defined(NDEBUG) || defined(HEADLESS)
+		// headless builds simulate rooms on many threads at once, with nothing to draw the boxes & text to
 		return true;
 #else
 		return !m_open;
@@ -80,9 +81,10 @@ private:
 
 	bool m_open		  = true;
 	bool m_draw_debug = false;
-	bool m_log_mode	  = false;
 	bool m_demo_open  = false;
 
+	static thread_local bool m_log_mode;   // set by get() & log(), per thread as both are called off the game thread
+
 	sf::Clock m_last_dt_reset_clock;   // for resetting m_last_dt
 	sf::Time m_last_dt;				   // stores imdraw() dt values so they don't have to be updated every frame, but can be staggered
 
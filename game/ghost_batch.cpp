@@ -0,0 +1,107 @@
+#include "ghost_batch.hpp"
+
+#include <algorithm>
+
+#include "resource.hpp"
+
+ghost_batch::ghost_batch()
+	: m_outer_offset(0),
+	  m_font(resource::get().font("assets/verdana.ttf")) {
+	// both halves of the player in one texture, so one draw covers them
+	sf::Image inner = resource::get().tex("assets/player_inner.png").copyToImage();
+	sf::Image outer = resource::get().tex("assets/player_outer.png").copyToImage();
+	sf::Image both;
+	both.create(std::max(inner.getSize().x, outer.getSize().x), inner.getSize().y + outer.getSize().y, sf::Color::Transparent);
+	both.copy(inner, 0, 0);
+	both.copy(outer, 0, inner.getSize().y);
+	m_player_tex.loadFromImage(both);
+	m_outer_offset = inner.getSize().y;
+}
+
+void ghost_batch::clear() {
+	m_players.clear();
+	m_tags.clear();
+}
+
+void ghost_batch::add_player(const sf::Transform& t, sf::IntRect frame, sf::Color fill, sf::Color outline) {
+	sf::FloatRect pos(0, 0, frame.width, frame.height);
+	sf::FloatRect uv(frame);
+	m_add_quad(m_players, t, pos, uv, fill);
+	uv.top += m_outer_offset;
+	m_add_quad(m_players, t, pos, uv, outline);
+}
+
+void ghost_batch::add_nametag(const sf::Transform& t, const std::string& name) {
+	for (const sf::Vertex& v : m_layout(name)) {
+		m_tags.emplace_back(t.transformPoint(v.position), v.color, v.texCoords);
+	}
+}
+
+const std::vector<sf::Vertex>& ghost_batch::m_layout(const std::string& name) {
+	auto it = m_tag_layouts.find(name);
+	if (it != m_tag_layouts.end()) return it->second;
+	if (m_tag_layouts.size() >= MAX_CACHED_TAGS) m_tag_layouts.clear();
+
+	// the same layout sf::Text would give, one line, no styles
+	const float whitespace = m_font.getGlyph(U' ', TAG_CHAR_SIZE, false).advance;
+	std::vector<sf::Vertex> glyphs;
+	sf::Uint32 prev = 0;
+	float x			= 0;
+	float y			= TAG_CHAR_SIZE;
+	// extents of the text, measured like sf::Text's bounds
+	float min_x = TAG_CHAR_SIZE, min_y = TAG_CHAR_SIZE;
+	float max_x = 0, max_y = 0;
+	for (sf::Uint32 c : sf::String(name)) {
+		x += m_font.getKerning(prev, c, TAG_CHAR_SIZE);
+		prev = c;
+		if (c == U' ' || c == U'\t') {
+			min_x = std::min(min_x, x);
+			min_y = std::min(min_y, y);
+			x += c == U' ' ? whitespace : whitespace * 4;
+			max_x = std::max(max_x, x);
+			max_y = std::max(max_y, y);
+			continue;
+		}
+		const sf::Glyph& g = m_font.getGlyph(c, TAG_CHAR_SIZE, false);
+		// a pixel of padding around each glyph, as sf::Text does, so filtering doesn't clip the edges
+		sf::FloatRect pos(x + g.bounds.left - 1, y + g.bounds.top - 1, g.bounds.width + 2, g.bounds.height + 2);
+		sf::FloatRect uv(g.textureRect.left - 1, g.textureRect.top - 1, g.textureRect.width + 2, g.textureRect.height + 2);
+		m_add_quad(glyphs, sf::Transform::Identity, pos, uv, sf::Color::White);
+		min_x = std::min(min_x, x + g.bounds.left);
+		min_y = std::min(min_y, y + g.bounds.top);
+		max_x = std::max(max_x, x + g.bounds.left + g.bounds.width);
+		max_y = std::max(max_y, y + g.bounds.top + g.bounds.height);
+		x += g.advance;
+	}
+	float w = std::max(0.f, max_x - min_x);
+	float h = std::max(0.f, max_y - min_y);
+
+	std::vector<sf::Vertex>& layout = m_tag_layouts[name];
+	// a dark backdrop first, textured from the white pixels every glyph page keeps at its top left
+	sf::FloatRect border(-(w + TAG_PADDING) / 2.f, -(h + TAG_PADDING) / 2.f, w + TAG_PADDING, h + TAG_PADDING);
+	m_add_quad(layout, sf::Transform::Identity, border, sf::FloatRect(1, 1, 0, 0), sf::Color(0, 0, 0, 127));
+	// then the text, placed with nametag's origin
+	for (sf::Vertex v : glyphs) {
+		v.position -= sf::Vector2f(w / 2.f, h / 1.4f);
+		layout.push_back(v);
+	}
+	return layout;
+}
+
+void ghost_batch::m_add_quad(std::vector<sf::Vertex>& va, const sf::Transform& t, sf::FloatRect pos, sf::FloatRect uv, sf::Color color) {
+	va.emplace_back(t.transformPoint(pos.left, pos.top), color, sf::Vector2f(uv.left, uv.top));
+	va.emplace_back(t.transformPoint(pos.left + pos.width, pos.top), color, sf::Vector2f(uv.left + uv.width, uv.top));
+	va.emplace_back(t.transformPoint(pos.left + pos.width, pos.top + pos.height), color, sf::Vector2f(uv.left + uv.width, uv.top + uv.height));
+	va.emplace_back(t.transformPoint(pos.left, pos.top + pos.height), color, sf::Vector2f(uv.left, uv.top + uv.height));
+}
+
+void ghost_batch::draw(sf::RenderTarget& t, sf::RenderStates s) const {
+	if (!m_players.empty()) {
+		s.texture = &m_player_tex;
+		t.draw(m_players.data(), m_players.size(), sf::Quads, s);
+	}
+	if (!m_tags.empty()) {
+		s.texture = &m_font.getTexture(TAG_CHAR_SIZE);
+		t.draw(m_tags.data(), m_tags.size(), sf::Quads, s);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// every multiplayer ghost in two draw calls: one vertex array of player sprites, tinted per vertex,
+/// and one of nametags, built from the font's glyph page with each name's layout cached
+class ghost_batch : public sf::Drawable {
+public:
+	ghost_batch();
+
+	void clear();	// call before adding this frame's ghosts
+
+	// a player sprite, drawn at frame from the player textures, through t
+	void add_player(const sf::Transform& t, sf::IntRect frame, sf::Color fill, sf::Color outline);
+	// a nametag centered on t's origin
+	void add_nametag(const sf::Transform& t, const std::string& name);
+
+	// same look as nametag
+	static constexpr unsigned TAG_CHAR_SIZE = 30;
+	static constexpr float TAG_PADDING		= 16.f;
+
+	// names laid out beyond this and the cache starts over
+	static constexpr std::size_t MAX_CACHED_TAGS = 256;
+
+private:
+	void draw(sf::RenderTarget& t, sf::RenderStates s) const;
+
+	sf::Texture m_player_tex;	// the inner frames, with the outer frames below them
+	int m_outer_offset;			// y of the outer frames in m_player_tex
+	std::vector<sf::Vertex> m_players;	 // quads
+
+	const sf::Font& m_font;
+	std::vector<sf::Vertex> m_tags;	  // quads
+	std::unordered_map<std::string, std::vector<sf::Vertex>> m_tag_layouts;	  // quads relative to the tag's center
+	const std::vector<sf::Vertex>& m_layout(const std::string& name);
+
+	static void m_add_quad(std::vector<sf::Vertex>& va, const sf::Transform& t, sf::FloatRect pos, sf::FloatRect uv, sf::Color color);
+};
@@ -15,7 +15,8 @@ int leaderboard_modal::m_next_id = 0;
 leaderboard_modal::leaderboard_modal(api::level& lvl)
 	: m_lvl(lvl),
 	  m_sort_opts{ "time", "author", "createdAt", "updatedAt" },
-	  m_order_opts{ "asc", "desc" } {
+	  m_order_opts{ "asc", "desc" },
+	  m_replay_id(-1) {
 	auto replay_query = context::get().replay_search_query();
 	auto sort_it	  = std::find_if(std::begin(m_sort_opts), std::end(m_sort_opts),
 									 [this, replay_query](const char* str) { return std::string(str) == replay_query.sortBy; });
@@ -66,6 +67,7 @@ void leaderboard_modal::m_update_query() {
 	auto& replay_query	= context::get().replay_search_query();
 	replay_query.sortBy = m_sort_opts[m_sort_selection];
 	replay_query.order	= m_order_opts[m_order_selection];
+	replay_query.raw	= false;   // replays are fetched when they're watched
 	if (m_api_handle.fetching()) return;
 
 	if (replay_query != m_last_query) {
@@ -79,6 +81,11 @@ void leaderboard_modal::m_update_query() {
 
 void leaderboard_modal::imdraw(fsm* sm) {
 	m_api_handle.poll();
+	m_replay_handle.poll();
+	if (m_replay_handle.ready() && m_replay_handle.get().success && !m_replay_handle.get().replays.empty()) {
+		sm->swap_state<states::edit>(m_lvl, replay(m_replay_handle.get().replays[0]));
+		m_replay_handle.reset();
+	}
 	std::string modal_title = "###Leaderboard" + std::to_string(m_ex_id);
 	ImGuiWindowFlags flags	= ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings;
 	if (ImGui::BeginPopup(modal_title.c_str(), flags)) {
@@ -206,8 +213,22 @@ void leaderboard_modal::imdraw(fsm* sm) {
 								ImGui::SetTooltip("Game has been updated since this replay was ran. May not work properly.");
 							}
 							ImGui::TableNextColumn();
+							ImGui::BeginDisabled(m_replay_handle.fetching());
 							if (ImGui::ImageButtonWithText(resource::get().imtex("assets/gui/download.png"), "Replay")) {
-								sm->swap_state<states::edit>(m_lvl, replay(score));
+								m_replay_id = score.id;
+								m_replay_handle.reset(api::get().fetch_replays(std::span<const int>(&m_replay_id, 1)));
+							}
+							ImGui::EndDisabled();
+							// anything left in the handle here failed, or the replay's gone
+							if (m_replay_handle.ready() && m_replay_id == score.id) {
+								ImGui::SameLine();
+								ImGui::TextColored(sf::Color::Red, "[!]");
+								if (ImGui::IsItemHovered()) {
+									ImGui::SetTooltip("Failed to fetch replay: %s", m_replay_handle.get().error.value_or("Replay not found").c_str());
+									if (ImGui::IsItemClicked()) {
+										m_replay_handle.reset();
+									}
+								}
 							}
 							ImGui::TableNextColumn();
 							// if we own this score
@@ -25,6 +25,8 @@ private:
 
 	api_handle<api::replay_search_response> m_api_handle;
 	api_handle<api::response> m_hide_handle;
+	api_handle<api::replays_response> m_replay_handle;	 // the replay being fetched to be watched
+	int m_replay_id;									 // and its id
 
 	const char* m_sort_opts[4];	  // api sortBy options
 	int m_sort_selection;
@@ -19,25 +19,40 @@
 int level_card::m_next_id		  = 0;
 int level_card::m_pinned_level_id = -1;
 
+const sf::Time level_card::UPLOAD_BUDGET = sf::milliseconds(4);
+int level_card::m_upload_frame			 = -1;
+sf::Time level_card::m_upload_time		 = sf::Time::Zero;
+
 level_card::level_card(api::level& lvl, sf::Color bg)
 	: m_bg(bg),
 	  m_lvl(lvl),
-	  m_tmap(resource::get().tex("assets/tiles.png"), 32, 32, 16),
 	  m_lb_modal(lvl),
 	  m_comment_modal(lvl),
 	  m_player_icon(lvl.author.fill, lvl.author.outline) {
 
-	m_map_tex.create(256, 256);
-	m_tmap.load(m_lvl.code);
-	m_map_tex.setView(sf::View(sf::FloatRect(0, 0, 512, 512)));
-	m_map_tex.setSmooth(true);
-	m_map_tex.clear(m_bg);
-	m_map_tex.draw(m_tmap);
-	m_map_tex.display();
+	// parsing & building the vertices of the preview happens on the io pool, behind anything the user's
+	// waiting on. the texture is fetched here as loading it has to happen on this thread
+	sf::Texture& tiles = resource::get().tex("assets/tiles.png");
+	m_tmap_future	   = io_pool::get().submit(io_pool::PREFETCH, io_pool::make_token(), [&tiles, code = m_lvl.code]() {
+		tilemap tmap(tiles, 32, 32, 16);
+		tmap.load(code);
+		return tmap;
+	});
 
 	m_ex_id = m_next_id++;
 }
 
+level_card::~level_card() {
+	// cards paged past before their preview was parsed don't need it anymore
+	io_pool::get().cancel(m_tmap_future.token());
+}
+
+void level_card::m_play() {
+	if (m_download_handle.fetching()) return;
+	api::get().ping_download(m_lvl.id);
+	m_download_handle.reset(api::get().download_level(m_lvl.id));
+}
+
 void level_card::imdraw(fsm* sm) {
 	// title / auth
 	ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(0xFB8CABFF), "%s", m_lvl.title.c_str());
@@ -58,13 +73,19 @@ void level_card::imdraw(fsm* sm) {
 	ImGui::SameLine();
 	ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(0xFB8CABFF), "#%d", m_lvl.id);
 	ImVec2 ip = ImGui::GetCursorScreenPos();
-	ImGui::Image(m_map_tex);
+	m_upload_preview();
+	if (m_preview) {
+		preview_atlas::imdraw(m_preview);
+	} else {
+		// placeholder until the preview is ready
+		ImGui::GetWindowDrawList()->AddRectFilled(ip, ImVec2(ip.x + 256, ip.y + 256), ImGui::GetColorU32(m_bg));
+		ImGui::Dummy(ImVec2(256, 256));
+	}
 	if (ImGui::IsItemHovered()) {
 		ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
 		ImGui::GetWindowDrawList()->AddImage(resource::get().imtex("assets/gui/download_large.png"), ip, ImVec2(ip.x + 256, ip.y + 256));
 		if (ImGui::IsMouseClicked(0)) {
-			api::get().ping_download(m_lvl.id);
-			sm->swap_state<states::edit>(m_lvl);
+			m_play();
 		}
 	}
 
@@ -125,13 +146,31 @@ void level_card::imdraw(fsm* sm) {
 
 	ImGui::SameLine();
 
+	ImGui::BeginDisabled(m_download_handle.fetching());
 	if (ImGui::ImageButtonWithText(resource::get().imtex("assets/gui/download.png"), downloads.c_str(), x16, uv0, uv1, fp, bg)) {
-		api::get().ping_download(m_lvl.id);
-		sm->swap_state<states::edit>(m_lvl);
+		m_play();
 	}
+	ImGui::EndDisabled();
 	if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
 		ImGui::SetTooltip("Total downloads");
 	}
+	m_download_handle.poll();
+	if (m_download_handle.ready()) {
+		auto res = m_download_handle.get();
+		if (res.success && res.level.has_value()) {
+			m_download_handle.reset();
+			sm->swap_state<states::edit>(*res.level);
+		} else {
+			ImGui::SameLine();
+			ImGui::TextColored(sf::Color::Red, "[!]");
+			if (ImGui::IsItemHovered()) {
+				ImGui::SetTooltip("Failed to download level: %s", res.error.value_or("Unknown error").c_str());
+				if (ImGui::IsItemClicked()) {
+					m_download_handle.reset();
+				}
+			}
+		}
+	}
 
 	ImGui::SameLine();
 
@@ -221,3 +260,18 @@ void level_card::imdraw(fsm* sm) {
 	ImGui::TextWrapped("%s", m_lvl.description.c_str());
 	ImGui::PopStyleColor();
 }
+
+void level_card::m_upload_preview() {
+	if (m_preview || !m_tmap_future.valid() || !util::ready(m_tmap_future)) return;
+	if (m_upload_frame != ImGui::GetFrameCount()) {
+		m_upload_frame = ImGui::GetFrameCount();
+		m_upload_time  = sf::Time::Zero;
+	}
+	// always let the first one through, so every frame makes progress
+	if (m_upload_time >= UPLOAD_BUDGET) return;
+	sf::Clock upload_clock;
+	tilemap tmap = m_tmap_future.get();
+	// levels still in the atlas (i.e. paging back in search) reuse their preview
+	m_preview = preview_atlas::get().render(tmap, m_bg);
+	m_upload_time += upload_clock.getElapsedTime();
+}
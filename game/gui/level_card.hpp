@@ -6,6 +6,7 @@
 #include "gui/comment_modal.hpp"
 #include "gui/leaderboard_modal.hpp"
 #include "gui/player_icon.hpp"
+#include "gui/preview_atlas.hpp"
 #include "imgui-SFML.h"
 #include "imgui.h"
 #include "imgui_internal.h"
@@ -13,6 +14,7 @@
 #include "api.hpp"
 #include "api_handle.hpp"
 #include "gui/gif.hpp"
+#include "io_pool.hpp"
 #include "tilemap.hpp"
 
 class fsm;
@@ -22,6 +24,7 @@ class user_modal;
 class level_card {
 public:
 	level_card(api::level& lvl, sf::Color bg = sf::Color(0xC8AD7FFF));
+	~level_card();
 
 	void imdraw(fsm* sm);
 
@@ -34,8 +37,14 @@ private:
 	sf::Color m_bg;
 	api::level m_lvl;
 	std::optional<api::vote> m_last_vote;
-	tilemap m_tmap;	  // tilemap generated from the level data
-	sf::RenderTexture m_map_tex;
+	preview_atlas::handle m_preview;	 // level preview, in the shared preview atlas
+	io_future<tilemap> m_tmap_future;	 // the level's tilemap, parsed on the io pool for the preview
+
+	// uploads the parsed preview to the atlas, if it's ready & there's time left this frame
+	void m_upload_preview();
+	static const sf::Time UPLOAD_BUDGET;   // time per frame to spend rendering previews
+	static int m_upload_frame;			   // imgui frame the upload time was last reset on
+	static sf::Time m_upload_time;		   // time spent rendering previews this frame
 
 	leaderboard_modal m_lb_modal;
 	comment_modal m_comment_modal;
@@ -44,5 +53,10 @@ private:
 
 	api_handle<api::vote_response> m_vote_handle;
 	api_handle<api::response> m_pin_handle;
+	api_handle<api::level_response> m_download_handle;	 // the level as it is now, to be played
+
+	// plays the level. what the card holds may have come from the cache, and be older than what's on the
+	// server, which replays have to be recorded against, so it's downloaded first
+	void m_play();
 };
 
@@ -109,9 +109,10 @@ void menu_bar::imdraw(std::string& info_msg, fsm* sm) {
 
 	// Authentication
 	if (auth::get().authed() && !m_auth_unresolved()) {
-		ImGui::GetWindowDrawList()->AddImage(reinterpret_cast<ImTextureID>(m_p_icon.get_tex().getNativeHandle()),
+		ImGui::GetWindowDrawList()->AddImage(m_p_icon.get()->imtex(),
 											 ImVec2(ImGui::GetCursorScreenPos().x, ImGui::GetCursorScreenPos().y + 5),
-											 ImVec2(ImGui::GetCursorScreenPos().x + 16, ImGui::GetCursorScreenPos().y + 16 + 5));
+											 ImVec2(ImGui::GetCursorScreenPos().x + 16, ImGui::GetCursorScreenPos().y + 16 + 5),
+											 m_p_icon.get()->uv0(), m_p_icon.get()->uv1());
 		ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 21);
 		ImGui::TextColored(sf::Color(228, 189, 255), "Welcome, %s!", auth::get().username().c_str());
 		if (ImGui::MenuItem("Profile")) {
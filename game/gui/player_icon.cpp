@@ -5,19 +5,34 @@
 
 #include "debug.hpp"
 
-player_icon::player_icon(sf::Color fill, sf::Color outline)
-	: player_icon(fill.toInteger(), outline.toInteger()) {
+icon_atlas::icon_atlas()
+	: texture_atlas(sf::Vector2i(ICON_SIZE, ICON_SIZE), PAGE_SLOTS, MAX_PAGES) {
+}
+
+icon_atlas& icon_atlas::get() {
+	static icon_atlas instance;
+	return instance;
 }
 
-player_icon::player_icon(int fill, int outline) {
-	m_player.set_animation("jump");
-	m_player.setScale(1.0, -1.0);
-	m_player.setPosition(0, 64);
+texture_atlas::handle icon_atlas::render(sf::Color fill, sf::Color outline, std::string anim) {
+	const std::string key = std::to_string(fill.toInteger()) + ":" + std::to_string(outline.toInteger()) + ":" + anim;
+	return texture_atlas::render(key, sf::View(sf::FloatRect(0, 0, ICON_SIZE, ICON_SIZE)), [&](sf::RenderTarget& t) {
+		player p;
+		p.set_animation(anim);
+		p.set_fill_color(fill);
+		p.set_outline_color(outline);
+		t.draw(p);
+	});
+}
 
-	m_player_rt.create(64, 64);
+player_icon::player_icon(sf::Color fill, sf::Color outline)
+	: m_fill(fill),
+	  m_outline(outline) {
+	m_update();
+}
 
-	set_fill_color(fill);
-	set_outline_color(outline);
+player_icon::player_icon(int fill, int outline)
+	: player_icon(sf::Color(fill), sf::Color(outline)) {
 }
 
 void player_icon::set_fill_color(int fill) {
@@ -29,38 +44,23 @@ void player_icon::set_outline_color(int outline) {
 }
 
 void player_icon::set_fill_color(sf::Color fill) {
-	m_player.set_fill_color(fill);
-	update();
+	m_fill = fill;
+	m_update();
 }
 
 void player_icon::set_outline_color(sf::Color outline) {
-	m_player.set_outline_color(outline);
-	update();
+	m_outline = outline;
+	m_update();
 }
 
-void player_icon::set_view(sf::View v) {
-	m_player_rt.setView(v);
-	update();
-}
-
-void player_icon::update() {
-	sf::RenderStates s;
-	s.transform *= getTransform();
-	m_player.update();
-
-	m_player_rt.clear(sf::Color::Transparent);
-	m_player_rt.draw(m_player, s);
-	m_player_rt.display();
+void player_icon::m_update() {
+	m_icon = icon_atlas::get().render(m_fill, m_outline);
 }
 
 void player_icon::imdraw(int xs, int ys) {
-	ImGui::Image(m_player_rt.getTexture(), sf::Vector2f(xs, ys));
-}
-
-const sf::Texture& player_icon::get_tex() {
-	return m_player_rt.getTexture();
+	texture_atlas::imdraw(m_icon, sf::Vector2f(xs, ys));
 }
 
-player& player_icon::get_player() {
-	return m_player;
+const texture_atlas::handle& player_icon::get() const {
+	return m_icon;
 }
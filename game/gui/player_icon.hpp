@@ -1,10 +1,31 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <string>
 
+#include "gui/texture_atlas.hpp"
 #include "player.hpp"
 
-class player_icon : public sf::Transformable {
+/* shared atlas of player thumbnails, rendering each unique fill, outline & animation frame once */
+class icon_atlas : public texture_atlas {
+public:
+	static icon_atlas& get();
+
+	static constexpr int ICON_SIZE	= 64;	// width & height of a single icon
+	static constexpr int PAGE_SLOTS = 8;	// icons per row & column of a page
+	static constexpr int MAX_PAGES	= 1;	// pages to allocate before unheld icons start being evicted
+
+	// retrieve the icon for the given colors, showing the first frame of the given animation
+	handle render(sf::Color fill, sf::Color outline, std::string anim = "jump");
+
+private:
+	icon_atlas();
+	icon_atlas(const icon_atlas&) = delete;
+	icon_atlas(icon_atlas&&)	  = delete;
+};
+
+// a player thumbnail, referencing its render in the icon atlas
+class player_icon {
 public:
 	player_icon(int fill, int outline);
 	player_icon(sf::Color fill, sf::Color outline);
@@ -14,16 +35,14 @@ public:
 	void set_fill_color(sf::Color fill);
 	void set_outline_color(sf::Color outline);
 
-	void set_view(sf::View v);
-
-	void update();
-
 	void imdraw(int xs, int ys);
 
-	const sf::Texture& get_tex();
-	player& get_player();
+	const texture_atlas::handle& get() const;	// the icon's slot in the atlas
 
 private:
-	player m_player;
-	sf::RenderTexture m_player_rt;
+	sf::Color m_fill;
+	sf::Color m_outline;
+	texture_atlas::handle m_icon;
+
+	void m_update();   // fetch the icon for the current colors
 };
@@ -0,0 +1,30 @@
+#include "preview_atlas.hpp"
+
+preview_atlas::preview_atlas()
+	: texture_atlas(sf::Vector2i(PREVIEW_SIZE, PREVIEW_SIZE), PAGE_SLOTS, MAX_PAGES) {
+}
+
+preview_atlas& preview_atlas::get() {
+	static preview_atlas instance;
+	return instance;
+}
+
+preview_atlas::handle preview_atlas::render(const tilemap& tmap, sf::Color bg) {
+	const sf::Vector2f map_sz = tmap.total_size();
+	return texture_atlas::render(m_key(tmap, bg), sf::View(sf::FloatRect(0, 0, map_sz.x, map_sz.y)), [&](sf::RenderTarget& t) {
+		sf::RectangleShape background(map_sz);
+		background.setFillColor(bg);
+		t.draw(background);
+		t.draw(tmap);
+	});
+}
+
+void preview_atlas::imdraw(const handle& h, sf::Vector2f size) {
+	texture_atlas::imdraw(h, size);
+}
+
+std::string preview_atlas::m_key(const tilemap& tmap, sf::Color bg) {
+	const sf::Vector2i sz = tmap.size();
+	return std::to_string(tmap.hash()) + ":" + std::to_string(sz.x) + "x" + std::to_string(sz.y) + ":" +
+		   std::to_string(tmap.count()) + ":" + std::to_string(bg.toInteger());
+}
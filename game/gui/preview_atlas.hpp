@@ -0,0 +1,32 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <string>
+
+#include "gui/texture_atlas.hpp"
+#include "tilemap.hpp"
+
+/* shared texture pages that level previews are rendered into, so cards don't each need their own render texture */
+class preview_atlas : public texture_atlas {
+public:
+	static preview_atlas& get();
+
+	static constexpr int PREVIEW_SIZE = 256;   // width & height of a single preview
+	static constexpr int PAGE_SLOTS	  = 8;	   // previews per row & column of a page
+	static constexpr int MAX_PAGES	  = 2;	   // pages to allocate before previews start being evicted
+
+	// retrieve the preview of a map with a given background, rendering it if it isn't in the atlas
+	handle render(const tilemap& tmap, sf::Color bg);
+
+	// draw a preview with imgui
+	static void imdraw(const handle& h, sf::Vector2f size = sf::Vector2f(PREVIEW_SIZE, PREVIEW_SIZE));
+
+private:
+	preview_atlas();
+	preview_atlas(const preview_atlas&) = delete;
+	preview_atlas(preview_atlas&&)		= delete;
+
+	// the map's hash, dimensions & tile count along with the background, so two maps with colliding hashes never share a slot
+	static std::string m_key(const tilemap& tmap, sf::Color bg);
+};
@@ -0,0 +1,121 @@
+#include "texture_atlas.hpp"
+
+#include "debug.hpp"
+
+texture_atlas::texture_atlas(sf::Vector2i slot_size, int page_slots, int max_pages)
+	: m_slot_size(slot_size),
+	  m_page_slots(page_slots),
+	  m_max_pages(max_pages),
+	  m_tick(0) {
+}
+
+texture_atlas::~texture_atlas() {
+}
+
+texture_atlas::handle texture_atlas::find(const std::string& key) {
+	auto it = m_index.find(key);
+	if (it == m_index.end()) return nullptr;
+	std::shared_ptr<slot> s = m_slots[it->second];
+	s->last_used			= ++m_tick;
+	return s;
+}
+
+texture_atlas::handle texture_atlas::render(const std::string& key, sf::View view, std::function<void(sf::RenderTarget&)> draw) {
+	if (handle h = find(key)) return h;
+
+	const int i = m_acquire();
+	if (m_slots[i]->last_used != 0) {
+		m_index.erase(m_slots[i]->key);
+	}
+	m_index[key]			= i;
+	std::shared_ptr<slot> s = m_slots[i];
+	s->key					= key;
+	s->last_used			= ++m_tick;
+
+	// render on its own first, a page can't be drawn from while it's being drawn to
+	if (m_scratch.getSize() != sf::Vector2u(m_slot_size)) {
+		m_scratch.create(m_slot_size.x, m_slot_size.y);
+	}
+	view.setViewport(sf::FloatRect(0, 0, 1, 1));
+	m_scratch.setView(view);
+	m_scratch.clear(sf::Color::Transparent);
+	draw(m_scratch);
+	m_scratch.display();
+
+	// then copy it into the slot, along with its edges stretched out over the border, so filtering near the
+	// edge of the slot blends with copies of its own pixels & not with the neighboring slot's
+	sf::RenderTexture& rt = *m_pages[i / (m_page_slots * m_page_slots)];
+	rt.setView(rt.getDefaultView());
+	const sf::IntRect& r = s->rect;
+	for (int dy = -1; dy <= 1; ++dy) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			// the whole image in the middle, a row, column or corner pixel of it around the outside
+			sf::IntRect src(dx == 1 ? r.width - 1 : 0, dy == 1 ? r.height - 1 : 0,
+							dx == 0 ? r.width : 1, dy == 0 ? r.height : 1);
+			sf::Sprite part(m_scratch.getTexture(), src);
+			part.setPosition(dx == -1 ? r.left - BORDER : dx == 1 ? r.left + r.width : r.left,
+							 dy == -1 ? r.top - BORDER : dy == 1 ? r.top + r.height : r.top);
+			part.setScale(dx == 0 ? 1 : BORDER, dy == 0 ? 1 : BORDER);
+			rt.draw(part, sf::RenderStates(sf::BlendNone));
+		}
+	}
+	rt.display();
+
+	return s;
+}
+
+void texture_atlas::imdraw(const handle& h, sf::Vector2f size) {
+	ImGui::Image(h->imtex(), size, h->uv0(), h->uv1());
+}
+
+int texture_atlas::m_acquire() {
+	// least recently used slot nobody is holding on to. unused slots have a last_used of 0, so they go first
+	int lru = -1;
+	for (int i = 0; i < m_slots.size(); ++i) {
+		if (m_slots[i].use_count() > 1) continue;
+		if (lru == -1 || m_slots[i]->last_used < m_slots[lru]->last_used) {
+			lru = i;
+		}
+	}
+	// grow while under the page limit, and past it only if every slot is held
+	if (lru == -1 || (m_slots[lru]->last_used != 0 && m_pages.size() < m_max_pages)) {
+		m_add_page();
+		lru = m_slots.size() - m_page_slots * m_page_slots;
+	}
+	return lru;
+}
+
+void texture_atlas::m_add_page() {
+	debug::log() << "Allocating texture atlas page " << m_pages.size() << "\n";
+	auto& rt = m_pages.emplace_back(std::make_unique<sf::RenderTexture>());
+	const sf::Vector2i pitch = m_slot_size + sf::Vector2i(BORDER * 2, BORDER * 2);
+	rt->create(pitch.x * m_page_slots, pitch.y * m_page_slots);
+	rt->setSmooth(true);
+	rt->clear(sf::Color::Transparent);
+	for (int y = 0; y < m_page_slots; ++y) {
+		for (int x = 0; x < m_page_slots; ++x) {
+			m_slots.push_back(std::make_shared<slot>(slot{
+				.tex	   = &rt->getTexture(),
+				.rect	   = sf::IntRect(x * pitch.x + BORDER, y * pitch.y + BORDER, m_slot_size.x, m_slot_size.y),
+				.key	   = "",
+				.last_used = 0,
+			}));
+		}
+	}
+}
+
+ImTextureID texture_atlas::slot::imtex() const {
+	return reinterpret_cast<ImTextureID>(tex->getNativeHandle());
+}
+
+// render textures are stored upside down, so the uvs are flipped vertically
+
+ImVec2 texture_atlas::slot::uv0() const {
+	const sf::Vector2f page_sz(tex->getSize());
+	return ImVec2(rect.left / page_sz.x, 1.f - rect.top / page_sz.y);
+}
+
+ImVec2 texture_atlas::slot::uv1() const {
+	const sf::Vector2f page_sz(tex->getSize());
+	return ImVec2((rect.left + rect.width) / page_sz.x, 1.f - (rect.top + rect.height) / page_sz.y);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "imgui.h"
+
+/* pages of equally sized slots that many small renders share, instead of each owning a render texture.
+ * pages are smoothed, so every slot has a 1px border repeating its edge pixels for filtering to blend into */
+class texture_atlas {
+public:
+	// slot_size: size of one slot in pixels, page_slots: slots per row & column of a page
+	// max_pages: pages to allocate before unheld slots start being evicted, least recently used first
+	texture_atlas(sf::Vector2i slot_size, int page_slots, int max_pages);
+	virtual ~texture_atlas();
+
+	// a single rendered image in the atlas
+	struct slot {
+		const sf::Texture* tex;	  // page texture the image is in
+		sf::IntRect rect;		  // where on the page the image is
+		std::string key;		  // what's currently rendered here, compared in full on every lookup
+		uint64_t last_used;		  // for lru eviction, 0 if never used
+
+		ImTextureID imtex() const;	 // imgui handle of the page texture
+		ImVec2 uv0() const;			 // top left uv of the image
+		ImVec2 uv1() const;			 // bottom right uv of the image
+	};
+	// slots are never evicted while a handle to them is held
+	typedef std::shared_ptr<const slot> handle;
+
+	// retrieve the slot rendered with the given key, or nullptr
+	handle find(const std::string& key);
+	// retrieve the slot rendered with the given key, rendering it with the given view & draw fn if it isn't in the atlas
+	handle render(const std::string& key, sf::View view, std::function<void(sf::RenderTarget&)> draw);
+
+	// draw an image with imgui
+	static void imdraw(const handle& h, sf::Vector2f size);
+
+private:
+	sf::Vector2i m_slot_size;
+	int m_page_slots;
+	int m_max_pages;
+
+	std::vector<std::unique_ptr<sf::RenderTexture>> m_pages;   // all allocated pages
+	std::vector<std::shared_ptr<slot>> m_slots;				   // every slot of every page
+	std::unordered_map<std::string, int> m_index;			   // slot index of each rendered key
+	uint64_t m_tick;										   // incremented on every lookup
+	sf::RenderTexture m_scratch;							   // slot sized, renders land here before being copied into their slot
+
+	static constexpr int BORDER = 1;   // pixels of repeated edge around each slot
+
+	int m_acquire();   // index of a free or evictable slot, adding a page if necessary
+	void m_add_page();
+};
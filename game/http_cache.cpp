@@ -0,0 +1,155 @@
+#include "http_cache.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+#include "debug.hpp"
+#include "json.hpp"
+
+http_cache::http_cache(std::filesystem::path dir, std::size_t capacity)
+	: m_dir(dir),
+	  m_capacity(capacity) {
+	std::error_code ec;
+	std::filesystem::create_directories(m_dir, ec);
+	if (ec) debug::log() << "could not create cache directory " << m_dir.string() << ": " << ec.message() << "\n";
+	m_load_index();
+}
+
+std::optional<http_cache::entry> http_cache::get(const std::string& path, const std::string& request) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto it = m_index.find(m_hash(path + "\n" + request));
+	if (it == m_index.end()) return {};
+	std::ifstream file(m_dir / it->second.content, std::ios::binary);
+	if (!file) {
+		// the body file went missing, forget about it
+		m_index.erase(it);
+		m_save_index();
+		return {};
+	}
+	return entry{
+		.body	= std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()),
+		.stored = it->second.stored,
+	};
+}
+
+bool http_cache::put(const std::string& path, const std::string& request, const std::string& body) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	std::string key		= m_hash(path + "\n" + request);
+	std::string content = m_hash(body);
+	std::time_t now		= std::time(nullptr);
+
+	auto it = m_index.find(key);
+	if (it != m_index.end()) {
+		if (content == it->second.content) {
+			// still valid, just renew it
+			it->second.stored = now;
+			m_save_index();
+			return false;
+		}
+	}
+
+	// identical bodies share a file
+	if (!std::filesystem::exists(m_dir / content)) {
+		std::ofstream file(m_dir / content, std::ios::binary);
+		if (!file) return false;
+		file << body;
+	}
+
+	std::string old_content = it != m_index.end() ? it->second.content : "";
+	m_index[key]			= index_entry{ .path = path, .content = content, .stored = now };
+	if (!old_content.empty()) m_release(old_content);
+
+	// evict the least recently validated responses
+	while (m_index.size() > m_capacity) {
+		auto oldest = m_index.begin();
+		for (auto i = m_index.begin(); i != m_index.end(); ++i) {
+			if (i->second.stored < oldest->second.stored) oldest = i;
+		}
+		std::string evicted = oldest->second.content;
+		m_index.erase(oldest);
+		m_release(evicted);
+	}
+
+	m_save_index();
+	return true;
+}
+
+void http_cache::invalidate(const std::string& prefix) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	std::vector<std::string> released;
+	for (auto it = m_index.begin(); it != m_index.end();) {
+		if (it->second.path.starts_with(prefix)) {
+			released.push_back(it->second.content);
+			it = m_index.erase(it);
+		} else {
+			++it;
+		}
+	}
+	if (released.empty()) return;
+	for (auto& content : released) {
+		m_release(content);
+	}
+	m_save_index();
+}
+
+std::string http_cache::m_hash(const std::string& data) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (unsigned char c : data) {
+		h ^= c;
+		h *= 0x100000001b3ULL;
+	}
+	std::ostringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << h;
+	return ss.str();
+}
+
+void http_cache::m_load_index() {
+	try {
+		std::ifstream file(m_dir / "index.json");
+		if (!file) return;
+		nlohmann::json j = nlohmann::json::parse(file);
+		for (auto& [key, e] : j.items()) {
+			m_index[key] = index_entry{
+				.path	 = e["path"].get<std::string>(),
+				.content = e["content"].get<std::string>(),
+				.stored	 = e["stored"].get<std::time_t>(),
+			};
+		}
+	} catch (const std::exception& e) {
+		debug::log() << "discarding corrupt response cache index: " << e.what() << "\n";
+		m_index.clear();
+	}
+}
+
+void http_cache::m_save_index() const {
+	nlohmann::json j = nlohmann::json::object();
+	for (auto& [key, e] : m_index) {
+		j[key] = {
+			{ "path", e.path },
+			{ "content", e.content },
+			{ "stored", e.stored },
+		};
+	}
+	// write & swap, so a crash mid-write doesn't lose the index
+	std::filesystem::path tmp = m_dir / "index.json.tmp";
+	{
+		std::ofstream file(tmp);
+		if (!file) return;
+		file << j.dump();
+	}
+	std::error_code ec;
+	std::filesystem::rename(tmp, m_dir / "index.json", ec);
+	if (ec) debug::log() << "could not save response cache index: " << ec.message() << "\n";
+}
+
+void http_cache::m_release(const std::string& content) {
+	for (auto& [key, e] : m_index) {
+		if (e.content == content) return;
+	}
+	std::error_code ec;
+	std::filesystem::remove(m_dir / content, ec);
+}
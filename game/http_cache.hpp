@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+/// persistent on-disk cache of api responses. response bodies are stored in files named after a hash of their
+/// contents, and an index file maps each request (path & body) to the response it last got
+class http_cache {
+public:
+	http_cache(std::filesystem::path dir, std::size_t capacity);
+
+	struct entry {
+		std::string body;	  // the response body
+		std::time_t stored;	  // when the response was last validated against the server
+	};
+
+	// look up the last response to a request
+	std::optional<entry> get(const std::string& path, const std::string& request);
+	// store the response to a request, returns false if it validated as unchanged from the one we had
+	bool put(const std::string& path, const std::string& request, const std::string& body);
+	// drop all responses to requests whose path starts with the given prefix
+	void invalidate(const std::string& prefix);
+
+private:
+	struct index_entry {
+		std::string path;	   // request path, for invalidation
+		std::string content;   // hash of the response body, i.e. its file name
+		std::time_t stored;
+	};
+
+	std::mutex m_mutex;
+	std::filesystem::path m_dir;
+	std::size_t m_capacity;
+	std::unordered_map<std::string, index_entry> m_index;	// request hash -> response
+
+	static std::string m_hash(const std::string& data);	  // stable 64-bit fnv-1a hash, in hex
+
+	void m_load_index();
+	void m_save_index() const;
+	void m_release(const std::string& content);	  // deletes a body file if no request references it anymore
+};
@@ -0,0 +1,142 @@
+#include "io_pool.hpp"
+
+#include <cstdlib>
+#include <unordered_map>
+
+// index of the worker the current thread is, or -1 if it isn't one
+static thread_local int t_worker = -1;
+// token of the job running on this thread
+static thread_local io_pool::cancel_token t_token;
+
+io_pool::io_pool(std::size_t threads)
+	: m_next_seq(0),
+	  m_stopping(false),
+	  m_workers(threads, worker{ .token = nullptr, .client = nullptr }),
+	  m_stats{ .requests = 0, .wire_bytes = 0, .body_bytes = 0, .busy = sf::Time::Zero, .jobs = 0 } {
+	for (std::size_t i = 0; i < threads; ++i) {
+		m_threads.emplace_back(&io_pool::m_work, this, i);
+	}
+}
+
+io_pool::~io_pool() {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stopping = true;
+	}
+	m_cv.notify_all();
+	for (auto& t : m_threads) {
+		t.join();
+	}
+}
+
+io_pool& io_pool::get() {
+	static io_pool instance(THREADS);
+	return instance;
+}
+
+io_pool::cancel_token io_pool::make_token() {
+	return std::make_shared<std::atomic<bool>>(false);
+}
+
+void io_pool::cancel(const cancel_token& token) {
+	if (!token) return;
+	token->store(true);
+	std::lock_guard<std::mutex> guard(m_mutex);
+	for (auto& w : m_workers) {
+		// httplib's stop() is safe to call from another thread, it shuts the socket down under the request
+		if (w.token == token && w.client) w.client->stop();
+	}
+}
+
+bool io_pool::cancelled() {
+	return t_token && t_token->load();
+}
+
+io_pool::cancelled_error::cancelled_error()
+	: std::runtime_error("Request cancelled") {
+}
+
+httplib::Client& io_pool::client(const std::string& host) {
+	// httplib clients aren't safe to share between threads, so each thread keeps its own connections
+	thread_local std::unordered_map<std::string, std::unique_ptr<httplib::Client>> clients;
+	auto& cli = clients[host];
+	if (!cli) {
+		cli = std::make_unique<httplib::Client>(host);
+		cli->set_keep_alive(true);
+		// level codes & replays compress well, both ways
+		cli->set_compress(true);
+		cli->set_default_headers({ { "Accept-Encoding", "gzip, deflate" } });
+		cli->set_logger([](const httplib::Request& req, const httplib::Response& res) {
+			// the body's decompressed by now, but content-length is still what came over the wire
+			std::size_t body = res.body.size();
+			std::size_t wire = res.has_header("Content-Length") ? std::strtoull(res.get_header_value("Content-Length").c_str(), nullptr, 10) : body;
+			io_pool& pool	 = get();
+			std::lock_guard<std::mutex> guard(pool.m_mutex);
+			pool.m_stats.requests++;
+			pool.m_stats.wire_bytes += wire;
+			pool.m_stats.body_bytes += body;
+		});
+#ifdef NO_VERIFY_CERTS
+		cli->enable_server_certificate_verification(false);
+#endif
+	}
+	if (t_worker != -1) {
+		// remember the connection in use, so the job can be cancelled mid-request
+		io_pool& pool = get();
+		std::lock_guard<std::mutex> guard(pool.m_mutex);
+		pool.m_workers[t_worker].client = cli.get();
+	}
+	// cancel() sets the flag before looking for the client, so from here on it'll find it and stop() the request.
+	// before here, it won't have, and the request has to be abandoned now
+	if (cancelled()) throw cancelled_error();
+	return *cli;
+}
+
+std::size_t io_pool::pending() const {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_jobs.size();
+}
+
+io_pool::stats io_pool::get_stats() const {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_stats;
+}
+
+bool io_pool::job::operator<(const job& other) const {
+	// priority_queue pops the greatest, so older jobs compare greater
+	if (p != other.p) return p < other.p;
+	return seq > other.seq;
+}
+
+void io_pool::m_push(priority p, cancel_token token, std::function<void()> fn) {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_jobs.push(job{ .p = p, .seq = m_next_seq++, .token = token, .fn = std::move(fn) });
+	}
+	m_cv.notify_one();
+}
+
+void io_pool::m_work(std::size_t index) {
+	t_worker = index;
+	while (true) {
+		job j;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+			if (m_stopping) return;
+			j = m_jobs.top();
+			m_jobs.pop();
+			if (j.token && j.token->load()) continue;
+			m_workers[index] = worker{ .token = j.token, .client = nullptr };
+		}
+		t_token = j.token;
+		sf::Clock job_clock;
+		j.fn();
+		sf::Time elapsed = job_clock.getElapsedTime();
+		t_token.reset();
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_workers[index] = worker{ .token = nullptr, .client = nullptr };
+		m_stats.busy += elapsed;
+		m_stats.jobs++;
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <SFML/System.hpp>
+
+#include "httplib.h"
+
+template <typename T>
+class io_future;
+
+/// fixed-size pool of threads that network requests are queued onto, run in order of priority (singleton)
+class io_pool {
+public:
+	static io_pool& get();
+
+	enum priority {
+		BACKGROUND = 0,	  // fire & forget pings, cache revalidation
+		PREFETCH,		  // speculative fetches the user may never look at
+		USER,			  // requests the user is actively waiting on
+	};
+
+	// shared flag that, once set, drops a queued job before it runs, or aborts the request of a running one
+	typedef std::shared_ptr<std::atomic<bool>> cancel_token;
+	static cancel_token make_token();
+
+	// queue a job. if it's cancelled before it starts, the future reports a broken promise
+	template <typename F>
+	io_future<std::invoke_result_t<F>> submit(priority p, cancel_token token, F&& fn);
+	// queue a job that can't be cancelled
+	template <typename F>
+	io_future<std::invoke_result_t<F>> submit(priority p, F&& fn);
+
+	// cancel a job, shutting down its connection if it's mid-request
+	void cancel(const cancel_token& token);
+	// has the job running on this thread been cancelled
+	static bool cancelled();
+
+	// thrown by client() to a job that's been cancelled, so it never starts its request
+	struct cancelled_error : std::runtime_error {
+		cancelled_error();
+	};
+
+	// the calling thread's connection to a host, kept alive between requests. every request fetches its client
+	// from here right before sending, so a job cancelled before then throws cancelled_error instead
+	static httplib::Client& client(const std::string& host);
+
+	std::size_t pending() const;   // number of jobs waiting to run
+
+	// running totals for gauging network usage
+	struct stats {
+		uint64_t requests;		// http requests completed
+		uint64_t wire_bytes;	// response bytes received, before decompression
+		uint64_t body_bytes;	// response bytes after decompression
+		sf::Time busy;			// total time spent running jobs
+		uint64_t jobs;			// jobs run
+	};
+	stats get_stats() const;
+
+private:
+	io_pool(std::size_t threads);
+	~io_pool();
+	io_pool(const io_pool& other) = delete;
+	io_pool(io_pool&& other)	  = delete;
+
+	static constexpr std::size_t THREADS = 4;
+
+	struct worker {
+		cancel_token token;			// token of the job it's running
+		httplib::Client* client;	// connection that job last used
+	};
+
+	struct job {
+		priority p;
+		uint64_t seq;	// submission order, so jobs of equal priority run first come first serve
+		cancel_token token;
+		std::function<void()> fn;
+
+		bool operator<(const job& other) const;
+	};
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::priority_queue<job> m_jobs;
+	uint64_t m_next_seq;
+	bool m_stopping;
+	std::vector<std::thread> m_threads;
+	std::vector<worker> m_workers;
+	stats m_stats;
+
+	void m_push(priority p, cancel_token token, std::function<void()> fn);
+	void m_work(std::size_t index);	  // worker thread loop
+};
+
+/// future for a job on the io_pool, along with the token to cancel it
+template <typename T>
+class io_future : public std::future<T> {
+public:
+	io_future() = default;
+	io_future(std::future<T>&& fut, io_pool::cancel_token token)
+		: std::future<T>(std::move(fut)),
+		  m_token(token) {
+	}
+
+	// null if the job can't be cancelled
+	const io_pool::cancel_token& token() const {
+		return m_token;
+	}
+
+private:
+	io_pool::cancel_token m_token;
+};
+
+template <typename F>
+io_future<std::invoke_result_t<F>> io_pool::submit(priority p, cancel_token token, F&& fn) {
+	auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(fn));
+	auto fut  = task->get_future();
+	m_push(p, token, [task]() { (*task)(); });
+	return io_future<std::invoke_result_t<F>>(std::move(fut), token);
+}
+
+template <typename F>
+io_future<std::invoke_result_t<F>> io_pool::submit(priority p, F&& fn) {
+	return submit(p, nullptr, std::forward<F>(fn));
+}
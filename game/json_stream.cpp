@@ -0,0 +1,137 @@
+#include "json_stream.hpp"
+
+json_array_stream::json_array_stream(std::string array_key, item_callback on_item)
+	: m_array_key(array_key),
+	  m_on_item(on_item),
+	  m_element(nullptr),
+	  m_depth(0),
+	  m_streaming(false),
+	  m_skip_key(false) {
+}
+
+bool json_array_stream::parse(const std::string& body) {
+	return nlohmann::json::sax_parse(body, this) && m_rest.is_object();
+}
+
+nlohmann::json& json_array_stream::rest() {
+	return m_rest;
+}
+
+bool json_array_stream::null() {
+	return m_value(nullptr);
+}
+
+bool json_array_stream::boolean(bool val) {
+	return m_value(val);
+}
+
+bool json_array_stream::number_integer(number_integer_t val) {
+	return m_value(val);
+}
+
+bool json_array_stream::number_unsigned(number_unsigned_t val) {
+	return m_value(val);
+}
+
+bool json_array_stream::number_float(number_float_t val, const string_t&) {
+	return m_value(val);
+}
+
+bool json_array_stream::string(string_t& val) {
+	return m_value(std::move(val));
+}
+
+bool json_array_stream::binary(binary_t& val) {
+	return m_value(nlohmann::json::binary(std::move(val)));
+}
+
+bool json_array_stream::start_object(std::size_t) {
+	return m_open(nlohmann::json::object());
+}
+
+bool json_array_stream::key(string_t& val) {
+	if (m_depth == 1 && val == m_array_key) {
+		m_skip_key = true;
+		return true;
+	}
+	m_skip_key = false;
+	m_element  = &(*m_stack.back())[std::move(val)];
+	return true;
+}
+
+bool json_array_stream::end_object() {
+	return m_close();
+}
+
+bool json_array_stream::start_array(std::size_t) {
+	if (m_depth == 1 && m_skip_key) {
+		// the array to stream, its elements each become their own document
+		m_depth++;
+		m_streaming = true;
+		return true;
+	}
+	return m_open(nlohmann::json::array());
+}
+
+bool json_array_stream::end_array() {
+	if (m_streaming && m_depth == 2) {
+		m_depth--;
+		m_streaming = false;
+		return true;
+	}
+	return m_close();
+}
+
+bool json_array_stream::parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
+	return false;
+}
+
+bool json_array_stream::m_value(nlohmann::json&& val) {
+	if (m_depth == 0) return false;	  // only objects at the top level
+	if (m_streaming && m_depth == 2) {
+		m_on_item(std::move(val));
+		return true;
+	}
+	if (m_depth == 1 && m_skip_key) return false;	// the streamed key has to hold an array
+	nlohmann::json* top = m_stack.back();
+	if (top->is_array()) {
+		top->push_back(std::move(val));
+	} else {
+		*m_element = std::move(val);
+	}
+	return true;
+}
+
+bool json_array_stream::m_open(nlohmann::json&& container) {
+	if (m_depth == 0) {
+		if (!container.is_object()) return false;
+		m_rest = std::move(container);
+		m_stack.push_back(&m_rest);
+	} else if (m_streaming && m_depth == 2) {
+		m_item = std::move(container);
+		m_stack.push_back(&m_item);
+	} else {
+		if (m_depth == 1 && m_skip_key) return false;
+		nlohmann::json* top = m_stack.back();
+		if (top->is_array()) {
+			top->push_back(std::move(container));
+			m_stack.push_back(&top->back());
+		} else {
+			*m_element = std::move(container);
+			m_stack.push_back(m_element);
+		}
+	}
+	m_depth++;
+	return true;
+}
+
+bool json_array_stream::m_close() {
+	m_stack.pop_back();
+	m_depth--;
+	if (m_streaming && m_depth == 2) {
+		// finished an element of the streamed array
+		m_on_item(std::move(m_item));
+		m_item = nullptr;
+	}
+	return true;
+}
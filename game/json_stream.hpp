@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+/// sax handler that streams the elements of an array in a json object (i.e. the levels in {"levels": [...], "cursor": 5})
+/// out one at a time as they're parsed, without building the whole document. strings are moved out of the parser
+/// rather than copied. the rest of the object's fields are collected as normal
+class json_array_stream : public nlohmann::json_sax<nlohmann::json> {
+public:
+	typedef std::function<void(nlohmann::json&& item)> item_callback;
+
+	json_array_stream(std::string array_key, item_callback on_item);
+
+	// parse a document, returns false if it's malformed or not an object
+	bool parse(const std::string& body);
+
+	nlohmann::json& rest();	  // every field of the object besides the streamed array
+
+	bool null() override;
+	bool boolean(bool val) override;
+	bool number_integer(number_integer_t val) override;
+	bool number_unsigned(number_unsigned_t val) override;
+	bool number_float(number_float_t val, const string_t& s) override;
+	bool string(string_t& val) override;
+	bool binary(binary_t& val) override;
+	bool start_object(std::size_t elements) override;
+	bool key(string_t& val) override;
+	bool end_object() override;
+	bool start_array(std::size_t elements) override;
+	bool end_array() override;
+	bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex) override;
+
+private:
+	std::string m_array_key;
+	item_callback m_on_item;
+
+	nlohmann::json m_rest;				   // the top level object, sans the array
+	nlohmann::json m_item;				   // the array element being built
+	std::vector<nlohmann::json*> m_stack;  // containers being built, innermost last
+	nlohmann::json* m_element;			   // the object field the next value goes in
+	int m_depth;						   // how many containers deep the parser is
+	bool m_streaming;					   // are we inside the streamed array
+	bool m_skip_key;					   // was the last key the streamed array's
+
+	bool m_value(nlohmann::json&& val);	  // place a scalar value
+	bool m_open(nlohmann::json&& container);
+	bool m_close();
+};
@@ -0,0 +1,14 @@
+#include "level_cache.hpp"
+
+level_cache::level_cache()
+	: m_blob_layouts(16) {
+}
+
+level_cache& level_cache::get() {
+	static level_cache instance;
+	return instance;
+}
+
+lru_cache<uint64_t, std::shared_ptr<const moving_tile_manager::layout>>& level_cache::blob_layouts() {
+	return m_blob_layouts;
+}
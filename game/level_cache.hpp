@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "lru_cache.hpp"
+#include "moving_tile.hpp"
+
+/* process-wide cache of data derived from level contents, keyed by tilemap::hash() */
+class level_cache {
+public:
+	static level_cache& get();
+
+	// moving blob layouts, so rebuilding a world from the same level skips blob labeling
+	lru_cache<uint64_t, std::shared_ptr<const moving_tile_manager::layout>>& blob_layouts();
+
+private:
+	level_cache();
+	level_cache(const level_cache&) = delete;
+	level_cache(level_cache&&)		= delete;
+
+	lru_cache<uint64_t, std::shared_ptr<const moving_tile_manager::layout>> m_blob_layouts;
+};
@@ -0,0 +1,459 @@
+#include "loopback_transport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <exception>
+#include <sstream>
+
+#include "auth.hpp"
+#include "context.hpp"
+#include "debug.hpp"
+#include "multiplayer.hpp"
+#include "net_buffer.hpp"
+#include "util.hpp"
+
+const sf::Time loopback_transport::FLUSH_INTERVAL = sf::milliseconds(50);
+
+std::optional<loopback_transport::config> loopback_transport::config::from_env() {
+	const char* env = std::getenv("BQR_LOOPBACK");
+	if (!env) return {};
+
+	config cfg;
+	std::istringstream options(env);
+	std::string opt;
+	while (options >> opt) {
+		std::size_t eq	  = opt.find('=');
+		std::string key	  = opt.substr(0, eq);
+		std::string value = eq == std::string::npos ? "" : opt.substr(eq + 1);
+		try {
+			if (key == "delay") {
+				cfg.delay = sf::milliseconds(std::stoi(value));
+			} else if (key == "jitter") {
+				cfg.jitter = sf::milliseconds(std::stoi(value));
+			} else if (key == "drop") {
+				cfg.drop = std::stof(value);
+			} else if (key == "reorder") {
+				cfg.reorder = std::stof(value);
+			} else if (key == "skew") {
+				cfg.skew = sf::milliseconds(std::stoi(value));
+			} else if (key == "seed") {
+				cfg.seed = std::stoul(value);
+			} else {
+				debug::log() << "unknown loopback option " << key << "\n";
+			}
+		} catch (const std::exception&) {
+			debug::log() << "bad value for loopback option " << key << ": " << value << "\n";
+		}
+	}
+
+	if (const char* bots = std::getenv("BQR_BOTS")) {
+		std::istringstream paths(bots);
+		std::string path;
+		while (std::getline(paths, path, ',')) {
+			if (!path.empty()) cfg.bots.push_back(path);
+		}
+	}
+	return cfg;
+}
+
+loopback_transport::loopback_transport(config cfg)
+	: m_cfg(cfg),
+	  m_rng(cfg.seed),
+	  m_open(false),
+	  m_announced(false),
+	  m_reliable_at{ sf::Time::Zero, sf::Time::Zero },
+	  m_self_id(-1),
+	  m_flushes(0) {
+	std::vector<int> ids;
+	for (auto& path : m_cfg.bots) {
+		if (std::all_of(path.begin(), path.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+			try {
+				ids.push_back(std::stoi(path));
+			} catch (const std::exception&) {
+				debug::log() << "skipping bot, bad replay id " << path << "\n";
+			}
+			continue;
+		}
+		replay rp;
+		try {
+			rp.load_from_file(path);
+		} catch (const std::exception& e) {
+			debug::log() << "skipping bot: " << e.what() << "\n";
+			continue;
+		}
+		m_add_bot(rp);
+	}
+	// every id in one batch request, rather than a request per bot
+	if (!ids.empty()) m_replays_handle.reset(api::get().fetch_replays(ids));
+}
+
+void loopback_transport::m_add_bot(const replay& rp) {
+	if (rp.size() == 0) return;
+	if (m_bot_replays.size() == MAX_BOTS) {
+		debug::log() << "only the first " << MAX_BOTS << " bots are used\n";
+		return;
+	}
+	m_bot_replays.push_back(rp);
+}
+
+void loopback_transport::set_open_listener(std::function<void()> l) {
+	m_open_listener = l;
+}
+
+void loopback_transport::set_close_listener(std::function<void()> l) {
+	m_close_listener = l;
+}
+
+void loopback_transport::set_fail_listener(std::function<void()> l) {
+	m_fail_listener = l;
+}
+
+void loopback_transport::connect(const std::string& url) {
+	// there's nothing to reach, the open listener's called from the next poll
+	m_open = true;
+}
+
+bool loopback_transport::opened() const {
+	return m_open;
+}
+
+void loopback_transport::close() {
+	bool was_open = m_open.exchange(false);
+	m_announced	  = false;
+	m_in_flight.clear();
+	m_reliable_at[0] = sf::Time::Zero;
+	m_reliable_at[1] = sf::Time::Zero;
+	m_self_id		 = -1;
+	m_reset_room();
+	if (was_open && m_close_listener) m_close_listener();
+}
+
+void loopback_transport::emit(const std::string& name, const sio::message::ptr& msg) {
+	if (!m_open) return;
+	m_send(true, name, msg);
+}
+
+void loopback_transport::on(const std::string& name, event_listener l) {
+	m_listeners[name] = l;
+}
+
+void loopback_transport::on_error(event_listener l) {
+	m_error_listener = l;
+}
+
+void loopback_transport::off_all() {
+	m_listeners.clear();
+	m_error_listener = nullptr;
+}
+
+bool loopback_transport::needs_token() const {
+	return false;
+}
+
+void loopback_transport::poll() {
+	if (!m_open) return;
+	if (!m_announced) {
+		m_announced = true;
+		if (m_open_listener) m_open_listener();
+	}
+
+	m_replays_handle.poll();
+	if (m_replays_handle.ready()) {
+		auto res = m_replays_handle.get();
+		m_replays_handle.reset();
+		if (res.success) {
+			for (auto& rp : res.replays) {
+				m_add_bot(replay(rp));
+			}
+			m_respawn_bots();
+		} else {
+			debug::log() << "couldn't fetch bot replays: " << res.error.value_or("unknown error") << "\n";
+		}
+	}
+
+	m_level_handle.poll();
+	if (m_level_handle.ready() && !m_level_handle.fetching()) {
+		auto res = m_level_handle.get();
+		m_level_handle.reset();
+		if (res.success && res.level.has_value() && m_room.has_value()) {
+			level l;
+			l.load_from_api(res.level.value());
+			m_spawn_bots(l);
+		} else {
+			debug::log() << "no bots, couldn't fetch the level: " << res.error.value_or("unknown error") << "\n";
+		}
+	}
+
+	m_step_bots();
+
+	sf::Time now = m_clock.getElapsedTime();
+	if (m_room.has_value() && now - m_last_flush >= FLUSH_INTERVAL) {
+		m_last_flush = now;
+		m_flush();
+	}
+
+	// anything sent while delivering arrives next poll at the earliest, the clock has moved on
+	while (!m_in_flight.empty() && m_in_flight.begin()->first <= now) {
+		packet p = std::move(m_in_flight.begin()->second);
+		m_in_flight.erase(m_in_flight.begin());
+		if (p.to_server) {
+			m_serve(p.name, p.msg);
+			continue;
+		}
+		auto it = m_listeners.find(p.name);
+		if (it != m_listeners.end()) it->second(p.msg);
+	}
+}
+
+sf::Time loopback_transport::m_random_delay() {
+	if (m_cfg.jitter <= sf::Time::Zero) return m_cfg.delay;
+	std::uniform_int_distribution<sf::Int64> jitter(0, m_cfg.jitter.asMicroseconds());
+	return m_cfg.delay + sf::microseconds(jitter(m_rng));
+}
+
+void loopback_transport::m_send(bool to_server, const std::string& name, sio::message::ptr msg) {
+	sf::Time at = m_clock.getElapsedTime() + m_random_delay();
+	if (name == "state_update") {
+		// the only traffic a real-time link would let go. anything else lost or out of order would
+		// desync the client in ways the real server never does
+		std::uniform_real_distribution<float> chance(0, 1);
+		if (chance(m_rng) < m_cfg.drop) return;
+		if (chance(m_rng) < m_cfg.reorder) at += FLUSH_INTERVAL + m_random_delay();
+	} else {
+		sf::Time& last = m_reliable_at[to_server ? 1 : 0];
+		at			   = std::max(at, last);
+		last		   = at;
+	}
+	m_in_flight.emplace(at, packet{ .to_server = to_server, .name = name, .msg = msg });
+}
+
+void loopback_transport::m_reply(const std::string& name, sio::message::ptr msg) {
+	m_send(false, name, msg);
+}
+
+sio::message::ptr loopback_transport::m_player_message(int id, const std::string& name, sf::Color fill, sf::Color outline) const {
+	auto data				   = sio::object_message::create();
+	data->get_map()["id"]	   = sio::int_message::create(id);
+	data->get_map()["name"]	   = sio::string_message::create(name);
+	data->get_map()["fill"]	   = sio::int_message::create(fill.toInteger());
+	data->get_map()["outline"] = sio::int_message::create(outline.toInteger());
+	return data;
+}
+
+sio::message::ptr loopback_transport::m_self_message() const {
+	return m_player_message(m_self_id, auth::get().username(), context::get().get_player_fill(), context::get().get_player_outline());
+}
+
+uint64_t loopback_transport::m_server_time() const {
+	return util::get_time() + m_cfg.skew.asMilliseconds();
+}
+
+void loopback_transport::m_serve(const std::string& name, const sio::message::ptr& msg) {
+	if (name == "authenticate") {
+		// everyone's let in as whoever they say they are
+		if (!msg || msg->get_flag() != sio::message::flag_object) return;
+		auto& data = msg->get_map();
+		if (!data.contains("id") || data["id"]->get_flag() != sio::message::flag_integer) return;
+		m_self_id = data["id"]->get_int();
+		m_reply("authorized");
+	} else if (name == "join") {
+		if (!msg || msg->get_flag() != sio::message::flag_integer) return;
+		if (m_room.has_value()) {
+			m_reply("warn", sio::string_message::create("You are already in a level!"));
+			return;
+		}
+		m_room					  = msg->get_int();
+		auto joined				  = m_self_message();
+		joined->get_map()["room"] = sio::string_message::create(std::to_string(m_room.value()));
+		m_reply("joined", joined);
+		auto everyone = sio::array_message::create();
+		everyone->get_vector().push_back(m_self_message());
+		m_reply("data_update", everyone);
+		// the bots join once they have a level to play
+		if (!m_bot_replays.empty()) m_level_handle.reset(api::get().download_level(m_room.value()));
+	} else if (name == "leave") {
+		if (!m_room.has_value()) return;
+		m_reply("left", sio::int_message::create(m_self_id));
+		m_reset_room();
+	} else if (name == "state_update") {
+		if (!m_room.has_value()) return;
+		if (!msg || msg->get_flag() != sio::message::flag_binary) return;
+		if (!m_apply_update(m_self_id, *msg->get_binary())) m_reply("state_resync");
+	} else if (name == "interest") {
+		if (!m_room.has_value()) return;
+		if (!msg || msg->get_flag() != sio::message::flag_object) return;
+		auto& hint = msg->get_map();
+		if (!hint.contains("x") || !hint.contains("y") || !hint.contains("max")) return;
+		if (hint["x"]->get_flag() != sio::message::flag_double || hint["y"]->get_flag() != sio::message::flag_double) return;
+		if (hint["max"]->get_flag() != sio::message::flag_integer) return;
+		float x = hint["x"]->get_double();
+		float y = hint["y"]->get_double();
+		if (!std::isfinite(x) || !std::isfinite(y)) return;
+		m_interest = interest{
+			.x		 = x,
+			.y		 = y,
+			.max	 = std::size_t(std::clamp<int64_t>(hint["max"]->get_int(), 1, MAX_INTEREST)),
+			.pending = m_interest.has_value() ? m_interest->pending : std::set<int>(),
+		};
+	} else if (name == "clock_sync") {
+		if (!msg || msg->get_flag() != sio::message::flag_integer) return;
+		auto times					 = sio::object_message::create();
+		times->get_map()["sent"]	 = sio::int_message::create(msg->get_int());
+		times->get_map()["received"] = sio::int_message::create(m_server_time());
+		times->get_map()["replied"]	 = sio::int_message::create(m_server_time());
+		m_reply("clock_sync", times);
+	} else if (name == "chat") {
+		if (!m_room.has_value()) return;
+		if (!msg || msg->get_flag() != sio::message::flag_string || msg->get_string().empty()) return;
+		auto chat					 = sio::object_message::create();
+		chat->get_map()["text"]		 = sio::string_message::create("[" + auth::get().username() + "#" + std::to_string(m_self_id) + "] " + msg->get_string());
+		chat->get_map()["authorId"]	 = sio::int_message::create(m_self_id);
+		chat->get_map()["createdAt"] = sio::int_message::create(std::time(nullptr));
+		m_reply("chat", chat);
+	}
+}
+
+bool loopback_transport::m_apply_update(int id, const std::string& update) {
+	stored_state next = m_states.contains(id) ? m_states.at(id) : stored_state{};
+	auto kind		  = multiplayer::apply_update(update, next.seq, next.state);
+	if (!kind) return false;
+	if (*kind == multiplayer::UPDATE_HEARTBEAT) return true;
+
+	// never trust the id the client sent
+	std::string id_bytes;
+	byte_writer w(id_bytes);
+	w.write(int32_t(id));
+	next.state.replace(1, id_bytes.size(), id_bytes);
+	next.dirty	 = true;
+	m_states[id] = std::move(next);
+	return true;
+}
+
+void loopback_transport::m_flush() {
+	bool far = ++m_flushes % FAR_FLUSH_EVERY == 0;
+	std::vector<int> dirty;
+	for (auto& [id, s] : m_states) {
+		if (s.dirty) dirty.push_back(id);
+		s.dirty = false;
+	}
+	if (dirty.empty() && !far) return;
+
+	std::string out;
+	if (!m_interest.has_value()) {
+		// hasn't said what it cares about, it gets everything
+		for (int id : dirty) {
+			out += m_states.at(id).state;
+		}
+	} else {
+		auto& pending = m_interest->pending;
+		pending.insert(dirty.begin(), dirty.end());
+		std::erase_if(pending, [this](int id) { return id == m_self_id || !m_states.contains(id); });
+		std::vector<int> ids(pending.begin(), pending.end());
+		if (!far && !ids.empty()) {
+			// the nearest players go out every flush, the rest only on far ones
+			std::vector<std::pair<float, int>> by_distance;
+			for (auto& [id, s] : m_states) {
+				if (id == m_self_id) continue;
+				byte_reader r(s.state.data(), s.state.size());
+				auto st = multiplayer::player_state::unpack(r);
+				if (!st) continue;
+				by_distance.push_back({ std::hypot(st->controls.xp - m_interest->x, st->controls.yp - m_interest->y), id });
+			}
+			std::size_t keep = std::min(by_distance.size(), m_interest->max);
+			std::partial_sort(by_distance.begin(), by_distance.begin() + keep, by_distance.end());
+			std::set<int> near;
+			for (std::size_t i = 0; i < keep; ++i) {
+				near.insert(by_distance[i].second);
+			}
+			std::erase_if(ids, [&near](int id) { return !near.contains(id); });
+		}
+		for (int id : ids) {
+			pending.erase(id);
+			out += m_states.at(id).state;
+		}
+	}
+	if (out.empty()) return;
+	m_reply("state_update", sio::binary_message::create(std::make_shared<const std::string>(std::move(out))));
+}
+
+void loopback_transport::m_reset_room() {
+	m_room = {};
+	m_states.clear();
+	m_interest = {};
+	m_bots.clear();
+	m_level_handle.reset();
+	m_flushes = 0;
+}
+
+void loopback_transport::m_spawn_bots(const level& l) {
+	m_bots_at = m_clock.getElapsedTime();
+	for (std::size_t i = 0; i < m_bot_replays.size(); ++i) {
+		const replay& rp = m_bot_replays[i];
+		std::string user = rp.get_user();
+		bot b{
+			.id	  = BOT_ID_BASE + int(i),
+			.name = "bot " + std::to_string(i + 1) + (user.empty() ? "" : " (" + user + ")"),
+			.rp	  = &rp,
+			.w	  = std::make_unique<world>(l, rp),
+			.step = 0,
+		};
+		b.w->set_muted(true);
+
+		auto joined				  = m_player_message(b.id, b.name, rp.fill(), rp.outline());
+		joined->get_map()["room"] = sio::string_message::create(std::to_string(m_room.value()));
+		m_reply("joined", joined);
+		m_bots.push_back(std::move(b));
+	}
+	debug::log() << m_bots.size() << " bots joined room #" << m_room.value() << "\n";
+}
+
+void loopback_transport::m_respawn_bots() {
+	if (!m_room.has_value() || m_bot_replays.empty()) return;
+	// the bots point into m_bot_replays, which has just grown, so they all leave & rejoin
+	for (auto& b : m_bots) {
+		m_states.erase(b.id);
+		if (m_interest.has_value()) m_interest->pending.erase(b.id);
+		m_reply("left", sio::int_message::create(b.id));
+	}
+	m_bots.clear();
+	m_level_handle.reset(api::get().download_level(m_room.value()));
+}
+
+void loopback_transport::m_step_bots() {
+	if (m_bots.empty()) return;
+	// after a stall, skip ahead rather than fast forwarding through it
+	const sf::Time max_behind = sf::milliseconds(250);
+	sf::Time now			  = m_clock.getElapsedTime();
+	if (now - m_bots_at > max_behind) m_bots_at = now - max_behind;
+	if (now - m_bots_at < replay::timestep) return;
+
+	while (now - m_bots_at >= replay::timestep) {
+		m_bots_at += replay::timestep;
+		for (auto& b : m_bots) {
+			// replays loop forever
+			if (b.step >= b.rp->size()) {
+				b.w->restart();
+				b.step = 0;
+			}
+			b.w->simulate(b.rp->get(b.step++));
+		}
+	}
+
+	// stored as if each bot had sent a keyframe of its newest state, stamped in server time as clients do
+	for (auto& b : m_bots) {
+		multiplayer::player_state s{
+			.id		   = b.id,
+			.controls  = b.w->get_player_control_vars(),
+			.anim	   = b.w->get_player_anim(),
+			.updatedAt = m_server_time(),
+		};
+		std::string packed	 = s.pack();
+		stored_state& stored = m_states[b.id];
+		if (!stored.state.empty() && multiplayer::player_state::same_packed(packed, stored.state)) continue;
+		stored.seq++;
+		stored.state = std::move(packed);
+		stored.dirty = true;
+	}
+}
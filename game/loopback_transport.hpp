@@ -0,0 +1,137 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "api.hpp"
+#include "api_handle.hpp"
+#include "level.hpp"
+#include "mp_transport.hpp"
+#include "replay.hpp"
+#include "world.hpp"
+
+/// stands in for both the socket and the server, so multiplayer can be tried without either. everything sent
+/// goes over a simulated link with the configured latency, jitter, loss & reordering, and the room can be
+/// filled with bots replaying .rpl files. all the work happens on the game thread in poll(), and the link's
+/// randomness is seeded, so the same config gives the same run
+class loopback_transport : public mp_transport {
+public:
+	struct config {
+		sf::Time delay	= sf::Time::Zero;	// one way
+		sf::Time jitter = sf::Time::Zero;	// up to this much more delay, picked at random for each message
+		float drop		= 0;				// chance a state_update is lost
+		float reorder	= 0;				// chance a state_update is held back another delay, landing behind later ones
+		sf::Time skew	= sf::Time::Zero;	// how far the server's clock is ahead of ours, for clock sync to find
+		unsigned seed	= 1;
+		std::vector<std::string> bots;	 // replays played as other players in whatever room is joined, files or ids
+
+		// from BQR_LOOPBACK, e.g. "delay=80 jitter=20 drop=0.05 reorder=0.02 skew=-3000 seed=7" (times in ms), and
+		// BQR_BOTS, e.g. "a.rpl,b.rpl,1234" where numbers are replay ids. empty if BQR_LOOPBACK isn't set
+		static std::optional<config> from_env();
+	};
+
+	loopback_transport(config cfg);
+
+	void set_open_listener(std::function<void()> l) override;
+	void set_close_listener(std::function<void()> l) override;
+	void set_fail_listener(std::function<void()> l) override;
+
+	void connect(const std::string& url) override;
+	bool opened() const override;
+	void close() override;
+
+	void emit(const std::string& name, const sio::message::ptr& msg = nullptr) override;
+	void on(const std::string& name, event_listener l) override;
+	void on_error(event_listener l) override;
+	void off_all() override;
+
+	bool needs_token() const override;
+	void poll() override;
+
+	// bot ids start here, well clear of real users
+	static constexpr int BOT_ID_BASE			  = 1 << 30;
+	static constexpr std::size_t MAX_BOTS		  = 64;
+	static constexpr std::size_t FAR_FLUSH_EVERY  = 10;	  // same as the real server
+	static constexpr std::size_t MAX_INTEREST	  = 64;
+	static const sf::Time FLUSH_INTERVAL;
+
+private:
+	config m_cfg;
+	std::mt19937 m_rng;
+	sf::Clock m_clock;	 // the link & the bots are timed off this
+
+	std::function<void()> m_open_listener;
+	std::function<void()> m_close_listener;
+	std::function<void()> m_fail_listener;
+	std::unordered_map<std::string, event_listener> m_listeners;
+	event_listener m_error_listener;
+
+	std::atomic<bool> m_open;	// set by connect(), which isn't always called from the game thread
+	bool m_announced;			// the open listener has heard about the current connection
+
+	// a message on the link, either way
+	struct packet {
+		bool to_server;
+		std::string name;
+		sio::message::ptr msg;
+	};
+	std::multimap<sf::Time, packet> m_in_flight;   // by when they arrive
+	sf::Time m_reliable_at[2];					   // when the last reliable message each way arrives, none may overtake it
+	void m_send(bool to_server, const std::string& name, sio::message::ptr msg);
+	sf::Time m_random_delay();
+
+	// the stand-in server, which acts like the real one for a single connection
+	struct stored_state {
+		uint16_t seq;
+		std::string state;	 // packed
+		bool dirty;			 // changed since the last flush
+	};
+	struct interest {
+		float x;
+		float y;
+		std::size_t max;
+		std::set<int> pending;	 // players whose newest state hasn't been sent yet
+	};
+	int m_self_id;	 // whoever the client authenticated as
+	std::optional<int> m_room;
+	std::map<int, stored_state> m_states;
+	std::optional<interest> m_interest;
+	sf::Time m_last_flush;
+	std::size_t m_flushes;
+	void m_serve(const std::string& name, const sio::message::ptr& msg);   // a message from the client arrived
+	void m_reply(const std::string& name, sio::message::ptr msg = nullptr);
+	// false if the update doesn't apply to what's stored, and the client needs to send a keyframe
+	bool m_apply_update(int id, const std::string& update);
+	void m_flush();
+	void m_reset_room();
+	sio::message::ptr m_player_message(int id, const std::string& name, sf::Color fill, sf::Color outline) const;
+	sio::message::ptr m_self_message() const;
+	uint64_t m_server_time() const;	  // util::get_time(), skewed
+
+	// replays played back as other players, on the level of the room joined
+	struct bot {
+		int id;
+		std::string name;
+		const replay* rp;
+		std::unique_ptr<world> w;
+		std::size_t step;
+	};
+	std::vector<replay> m_bot_replays;
+	std::vector<bot> m_bots;
+	api_handle<api::replays_response> m_replays_handle;	  // the bots given as replay ids, fetched together
+	api_handle<api::level_response> m_level_handle;
+	sf::Time m_bots_at;	  // how far the bots have been simulated
+	void m_spawn_bots(const level& l);
+	void m_add_bot(const replay& rp);
+	void m_respawn_bots();	 // after more replays have arrived
+	void m_step_bots();
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+/// a thread-safe, fixed capacity map that evicts the least recently used entry when full
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class lru_cache {
+public:
+	lru_cache(std::size_t capacity)
+		: m_capacity(capacity) {
+	}
+
+	// retrieve a value, marking it as most recently used
+	std::optional<Value> get(const Key& key) {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		auto it = m_index.find(key);
+		if (it == m_index.end()) return {};
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		return it->second->second;
+	}
+
+	// insert or replace a value, evicting the least recently used one if over capacity
+	void put(const Key& key, Value value) {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		auto it = m_index.find(key);
+		if (it != m_index.end()) {
+			it->second->second = std::move(value);
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			return;
+		}
+		m_entries.emplace_front(key, std::move(value));
+		m_index[key] = m_entries.begin();
+		if (m_entries.size() > m_capacity) {
+			m_index.erase(m_entries.back().first);
+			m_entries.pop_back();
+		}
+	}
+
+	// drop a value, if present
+	void erase(const Key& key) {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		auto it = m_index.find(key);
+		if (it == m_index.end()) return;
+		m_entries.erase(it->second);
+		m_index.erase(it);
+	}
+
+	void clear() {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_entries.clear();
+		m_index.clear();
+	}
+
+	std::size_t size() const {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		return m_entries.size();
+	}
+
+private:
+	mutable std::mutex m_mutex;
+	std::size_t m_capacity;
+
+	std::list<std::pair<Key, Value>> m_entries;	  // most recently used first
+	std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hash> m_index;
+};
@@ -1,6 +1,7 @@
 #include "moving_tile.hpp"
 
 #include "debug.hpp"
+#include "level_cache.hpp"
 #include "resource.hpp"
 #include "tilemap.hpp"
 
@@ -29,23 +30,96 @@ static sf::Vector2f tile_dir_vel(moving_blob::dir d, float v) {
 
 moving_tile_manager::moving_tile_manager(tilemap& t)
 	: m_tmap(t) {
-	// initialize all moving tiles
-	pos_set checked;
-	for (int y = 0; y < t.size().y; ++y) {
-		for (int x = 0; x < t.size().x; ++x) {
-			if (checked.contains({ x, y })) {
-				continue;
+	const uint64_t key				= t.hash();
+	std::shared_ptr<const layout> l = level_cache::get().blob_layouts().get(key).value_or(nullptr);
+	// the hash alone can collide, only trust a layout derived from exactly these tiles
+	auto same_tile = [](const tile& a, const tile& b) { return a.eq(b); };
+	if (l && !std::equal(l->source.begin(), l->source.end(), t.get().begin(), t.get().end(), same_tile)) {
+		l = nullptr;
+	}
+	const bool cached = !!l;
+	if (!cached) {
+		l = std::make_shared<const layout>(m_label(t));
+	}
+
+	m_blobs.reserve(l->offsets.size() - 1);
+	for (int b = 0; b + 1 < l->offsets.size(); ++b) {
+		moving_blob blob(t);
+		blob.init(std::span<const int>(l->indices).subspan(l->offsets[b], l->offsets[b + 1] - l->offsets[b]));
+		m_blobs.push_back(blob);
+	}
+
+	if (cached) {
+		if (l->stripped) t.restore(l->stripped);
+		return;
+	}
+	// take the moving tiles out of the static map, and remember the result
+	// (a map without moving tiles is left as is, so the cache doesn't pin its storage)
+	std::vector<tile> source = t.get();
+	const int xs			 = t.size().x;
+	for (int i : l->indices) {
+		t.clear(i % xs, i / xs);
+	}
+	auto stored		 = std::make_shared<layout>(*l);
+	stored->source	 = std::move(source);
+	stored->stripped = l->indices.empty() ? nullptr : t.snapshot();
+	level_cache::get().blob_layouts().put(key, stored);
+}
+
+moving_tile_manager::layout moving_tile_manager::m_label(const tilemap& t) {
+	const int xs = t.size().x;
+	const int ys = t.size().y;
+
+	// label all moving tiles in one row-major pass. blobs only ever extend along their start tile's axis of
+	// motion, so the only run that can reach a tile is a vertical one from the north, or failing that a
+	// horizontal one from the west. the north wins as it was started on an earlier row
+	std::vector<int> labels(xs * ys, -1);
+	std::vector<int> label_sizes;
+	std::vector<int> label_moving;	 // props.moving of each blob's start tile
+	auto is_horizontal = [](int moving) {
+		const moving_blob::dir d = moving_blob::dir(moving - 1);
+		return d == moving_blob::left || d == moving_blob::right;
+	};
+	for (int y = 0; y < ys; ++y) {
+		for (int x = 0; x < xs; ++x) {
+			const int i = x + y * xs;
+			int run		= -1;
+			if (y > 0 && labels[i - xs] != -1 && !is_horizontal(label_moving[labels[i - xs]])) {
+				run = labels[i - xs];
+			} else if (x > 0 && labels[i - 1] != -1 && is_horizontal(label_moving[labels[i - 1]])) {
+				run = labels[i - 1];
 			}
 			tile tl = t.get(x, y);
-			if (tl.props.moving != 0) {
-				moving_blob b(t);
-				b.init(x, y, checked);
-				m_blobs.push_back(b);
-			} else {
-				checked.insert({ x, y });
+			if (run != -1) {
+				// match only tiles moving in the exact same direction & also movable. anything else stops
+				// the run and stays static, even if it moves itself
+				if (tl.props.moving == label_moving[run] && tl.movable()) {
+					labels[i] = run;
+					label_sizes[run]++;
+				}
+				continue;
 			}
+			if (tl.props.moving == 0) continue;
+			// the start tile itself doesn't have to be movable
+			labels[i] = label_sizes.size();
+			label_sizes.push_back(1);
+			label_moving.push_back(tl.props.moving);
 		}
 	}
+
+	// bucket the tile indices by label, keeping them in row-major (min to max) order
+	layout l;
+	l.offsets.resize(label_sizes.size() + 1, 0);
+	for (int b = 0; b < label_sizes.size(); ++b) {
+		l.offsets[b + 1] = l.offsets[b] + label_sizes[b];
+	}
+	l.indices.resize(l.offsets.back());
+	std::vector<int> cursor(l.offsets.begin(), l.offsets.end() - 1);
+	for (int i = 0; i < labels.size(); ++i) {
+		if (labels[i] == -1) continue;
+		l.indices[cursor[labels[i]]++] = i;
+	}
+	return l;
 }
 
 void moving_tile_manager::draw(sf::RenderTarget& t, sf::RenderStates s) const {
@@ -174,71 +248,46 @@ moving_blob::moving_blob(tilemap& m)
 	  m_yv(0) {
 }
 
-void moving_blob::init(int x, int y, pos_set& checked) {
-	if (checked.contains({ x, y })) {
-		return;
-	}
-	checked.insert({ x, y });
-	if (m_initialized) {
-		// match only tiles moving in the exact same direction & also movable
-		tile t = m_tmap.get(x, y);
-		if (dir(t.props.moving - 1) != m_start_dir || !t.movable()) {
-			return;
-		}
-	}
-	moving_tile mt(m_tmap.get(x, y), m_tmap);
-	m_tiles.push_back(mt);
-	m_tmap.clear(x, y);
-
-	bool is_this_recurse_main = false;
-	if (!m_initialized) {
-		m_initialized		 = true;
-		m_start_dir			 = dir(tile(mt).props.moving - 1);
-		sf::Vector2f iv		 = tile_dir_vel(m_start_dir, phys.vel);
-		m_xv				 = iv.x;
-		m_yv				 = iv.y;
-		is_this_recurse_main = true;
-	}
-	m_min_xp = std::min<int>(m_min_xp, x);
-	m_min_yp = std::min<int>(m_min_yp, y);
-	m_max_xp = std::max<int>(m_max_xp, x);
-	m_max_yp = std::max<int>(m_max_yp, y);
-
-	if (std::abs(m_xv) > 0.01f) {
-		// check on left and right
-		init(x - 1, y, checked);
-		init(x + 1, y, checked);
-	} else if (std::abs(m_yv) > 0.01f) {
-		init(x, y - 1, checked);
-		init(x, y + 1, checked);
+void moving_blob::init(std::span<const int> indices) {
+	const int xs = m_tmap.size().x;
+	m_tiles.reserve(indices.size());
+	for (int i : indices) {
+		const int x = i % xs;
+		const int y = i / xs;
+		moving_tile mt(m_tmap.get(x, y), m_tmap);
+		m_tiles.push_back(mt);
+
+		m_min_xp = std::min<int>(m_min_xp, x);
+		m_min_yp = std::min<int>(m_min_yp, y);
+		m_max_xp = std::max<int>(m_max_xp, x);
+		m_max_yp = std::max<int>(m_max_yp, y);
 	}
 
-	// final cleanup steps
-	if (is_this_recurse_main) {
-		m_xp = m_min_xp;
-		m_yp = m_min_yp;
+	m_initialized	= true;
+	m_start_dir		= dir(tile(m_tiles.front()).props.moving - 1);
+	sf::Vector2f iv	= tile_dir_vel(m_start_dir, phys.vel);
+	m_xv			= iv.x;
+	m_yv			= iv.y;
 
-		m_start_x = m_xp;
-		m_start_y = m_yp;
+	m_xp = m_min_xp;
+	m_yp = m_min_yp;
 
-		// sort the tiles from min to max
-		std::sort(m_tiles.begin(), m_tiles.end(), [](const moving_tile& a, const moving_tile& b) -> bool {
-			return a.m_start_x < b.m_start_x || a.m_start_y < b.m_start_y;
-		});
-		// set the tiles positions
-		for (int i = 0; i < m_tiles.size(); ++i) {
-			moving_tile& s = m_tiles[i];
-			if (std::abs(m_xv) > 0.01f) {
-				s.setPosition(m_tmap.tile_size() * i, 0);
-			} else if (std::abs(m_yv) > 0.01f) {
-				s.setPosition(0, m_tmap.tile_size() * i);
-			}
-		}
+	m_start_x = m_xp;
+	m_start_y = m_yp;
 
-		// just in case :3
-		m_sync_position();
-		m_sync_position();
+	// set the tiles positions, indices are already sorted from min to max
+	for (int i = 0; i < m_tiles.size(); ++i) {
+		moving_tile& s = m_tiles[i];
+		if (std::abs(m_xv) > 0.01f) {
+			s.setPosition(m_tmap.tile_size() * i, 0);
+		} else if (std::abs(m_yv) > 0.01f) {
+			s.setPosition(0, m_tmap.tile_size() * i);
+		}
 	}
+
+	// just in case :3
+	m_sync_position();
+	m_sync_position();
 }
 
 void moving_blob::intersects(sf::FloatRect aabb, std::vector<std::pair<sf::Vector2f, tile>>& out) const {
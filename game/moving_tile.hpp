@@ -1,7 +1,8 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
-#include <unordered_set>
+#include <memory>
+#include <span>
 #include <vector>
 
 #include "tilemap.hpp"
@@ -10,8 +11,6 @@
 class moving_tile;
 class moving_blob;
 
-typedef std::unordered_set<sf::Vector2i, util::vector_hash<int>> pos_set;
-
 // manages all moving tiles, including collision between eachother
 class moving_tile_manager : public sf::Drawable, public sf::Transformable {
 public:
@@ -26,9 +25,19 @@ public:
 	// all moving tiles that intersect the given aabb
 	std::vector<std::pair<sf::Vector2f, moving_tile>> intersects_raw(sf::FloatRect aabb) const;
 
+	// where the blobs of a map are, derived once per map contents and shared by every manager built from it
+	struct layout {
+		std::vector<int> offsets;							// where each blob starts in indices, plus one past the last blob
+		std::vector<int> indices;							// row-major indices of all moving tiles, grouped by blob
+		std::shared_ptr<const tilemap::storage> stripped;	// the map with all moving tiles taken out, if there were any
+		std::vector<tile> source;							// the map it was derived from. hashes can collide, a hit must match it
+	};
+
 private:
 	void draw(sf::RenderTarget&, sf::RenderStates) const;
 
+	static layout m_label(const tilemap& t);   // find all blobs in the map
+
 	std::vector<moving_blob> m_blobs;							 // all moving tiles
 	std::unordered_map<int, std::vector<int>> m_tile_cohesion;	 // all
 
@@ -43,8 +52,8 @@ class moving_blob : public sf::Drawable, public sf::Transformable {
 public:
 	moving_blob(tilemap& m);
 
-	// merge all linked tiles at the given position into this blob, and mark them as checked
-	void init(int x, int y, pos_set& checked);
+	// copy all the given linked tiles (row-major tile indices, sorted) from the tilemap into this blob
+	void init(std::span<const int> indices);
 
 	// all moving tiles of this blob that intersect the given aabb
 	void intersects(sf::FloatRect aabb, std::vector<std::pair<sf::Vector2f, tile>>& out) const;
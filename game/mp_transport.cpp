@@ -0,0 +1,45 @@
+#include "mp_transport.hpp"
+
+void sio_transport::set_open_listener(std::function<void()> l) {
+	m_client.set_open_listener(l);
+}
+
+void sio_transport::set_close_listener(std::function<void()> l) {
+	m_client.set_close_listener([l](sio::client::close_reason const&) { l(); });
+}
+
+void sio_transport::set_fail_listener(std::function<void()> l) {
+	m_client.set_fail_listener(l);
+}
+
+void sio_transport::connect(const std::string& url) {
+	m_client.connect(url);
+}
+
+bool sio_transport::opened() const {
+	return m_client.opened();
+}
+
+void sio_transport::close() {
+	m_client.close();
+}
+
+void sio_transport::emit(const std::string& name, const sio::message::ptr& msg) {
+	if (msg) {
+		m_client.socket()->emit(name, msg);
+	} else {
+		m_client.socket()->emit(name);
+	}
+}
+
+void sio_transport::on(const std::string& name, event_listener l) {
+	m_client.socket()->on(name, [l](sio::event& ev) { l(ev.get_message()); });
+}
+
+void sio_transport::on_error(event_listener l) {
+	m_client.socket()->on_error(l);
+}
+
+void sio_transport::off_all() {
+	m_client.socket()->off_all();
+}
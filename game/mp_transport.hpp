@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include "sio_client.h"
+
+/// what multiplayer talks to the server through, named events carrying socket.io messages.
+/// the real one wraps a socket.io client, loopback_transport stands in for the server for local testing
+class mp_transport {
+public:
+	typedef std::function<void(const sio::message::ptr& msg)> event_listener;
+
+	virtual ~mp_transport() = default;
+
+	virtual void set_open_listener(std::function<void()> l)	 = 0;
+	virtual void set_close_listener(std::function<void()> l) = 0;
+	virtual void set_fail_listener(std::function<void()> l)	 = 0;
+
+	virtual void connect(const std::string& url) = 0;
+	virtual bool opened() const					 = 0;
+	virtual void close()						 = 0;
+
+	virtual void emit(const std::string& name, const sio::message::ptr& msg = nullptr) = 0;
+	virtual void on(const std::string& name, event_listener l)						   = 0;
+	virtual void on_error(event_listener l)											   = 0;
+	virtual void off_all()															   = 0;
+
+	// does connecting need a multiplayer token from the api first
+	virtual bool needs_token() const {
+		return true;
+	}
+	// called once per frame from the game loop, for transports that do their work there
+	virtual void poll() { }
+};
+
+/// the real server, over socket.io. listeners are called from the client's own thread
+class sio_transport : public mp_transport {
+public:
+	void set_open_listener(std::function<void()> l) override;
+	void set_close_listener(std::function<void()> l) override;
+	void set_fail_listener(std::function<void()> l) override;
+
+	void connect(const std::string& url) override;
+	bool opened() const override;
+	void close() override;
+
+	void emit(const std::string& name, const sio::message::ptr& msg = nullptr) override;
+	void on(const std::string& name, event_listener l) override;
+	void on_error(event_listener l) override;
+	void off_all() override;
+
+private:
+	sio::client m_client;
+};
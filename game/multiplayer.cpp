@@ -1,10 +1,16 @@
 #include "multiplayer.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <functional>
+#include <thread>
 #include <vector>
 
 #include "debug.hpp"
 #include "gui/player_icon.hpp"
+#include "loopback_transport.hpp"
 #include "player.hpp"
 #include "player_ghost.hpp"
 #include "resource.hpp"
@@ -24,34 +30,155 @@ multiplayer::player_state multiplayer::player_state::empty(int id) {
 	};
 }
 
-sio::message::ptr multiplayer::player_state::to_message() const {
-	auto ptr					= sio::object_message::create();
-	ptr->get_map()["id"]		= sio::int_message::create(auth::get().id());
-	ptr->get_map()["controls"]	= controls.to_message();
-	ptr->get_map()["anim"]		= sio::string_message::create(anim);
-	ptr->get_map()["updatedAt"] = sio::int_message::create(updatedAt);
-	return ptr;
+// animations are sent as an index into this list, append only
+static const std::array<std::string, 7> ANIMATIONS = { "stand", "walk", "jump", "fall", "dash", "climb", "hang" };
+
+std::string multiplayer::player_state::pack() const {
+	std::string out;
+	out.reserve(PACKED_SIZE);
+	byte_writer w(out);
+	w.write(VERSION);
+	w.write(int32_t(id));
+	w.write(uint64_t(updatedAt));
+	controls.pack(w);
+	auto anim_it = std::find(ANIMATIONS.begin(), ANIMATIONS.end(), anim);
+	w.write(uint8_t(anim_it == ANIMATIONS.end() ? 0 : anim_it - ANIMATIONS.begin()));
+	return out;
 }
 
-multiplayer::player_state multiplayer::player_state::from_message(const sio::message::ptr& msg) {
-	auto data = msg->get_map();
+std::optional<multiplayer::player_state> multiplayer::player_state::unpack(byte_reader& r) {
+	if (r.read<uint8_t>() != VERSION) return {};
 	multiplayer::player_state s;
-	s.id		= data["id"]->get_int();
-	s.controls	= world::control_vars::from_message(data["controls"]);
-	s.anim		= data["anim"]->get_string();
-	s.updatedAt = data["updatedAt"]->get_int();
+	s.id		 = r.read<int32_t>();
+	s.updatedAt	 = r.read<uint64_t>();
+	s.controls	 = world::control_vars::unpack(r);
+	uint8_t anim = r.read<uint8_t>();
+	s.anim		 = anim < ANIMATIONS.size() ? ANIMATIONS[anim] : "stand";
+	if (r.failed()) return {};
 	return s;
 }
 
+// updatedAt is different every time, it alone doesn't make a state worth sending
+static constexpr std::size_t UPDATED_AT_BEGIN = 5;
+static constexpr std::size_t UPDATED_AT_END	  = 13;
+
+bool multiplayer::player_state::same_packed(const std::string& a, const std::string& b) {
+	if (a.size() != b.size()) return false;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		if (i >= UPDATED_AT_BEGIN && i < UPDATED_AT_END) continue;
+		if (a[i] != b[i]) return false;
+	}
+	return true;
+}
+
+std::string multiplayer::encode_keyframe(uint16_t seq, const std::string& packed) {
+	std::string msg;
+	byte_writer w(msg);
+	w.write(uint8_t(UPDATE_KEYFRAME));
+	w.write(seq);
+	msg += packed;
+	return msg;
+}
+
+std::string multiplayer::encode_delta(uint16_t base_seq, const std::string& base, const std::string& packed) {
+	std::string msg;
+	byte_writer w(msg);
+	w.write(uint8_t(UPDATE_DELTA));
+	w.write(uint16_t(base_seq + 1));
+	w.write(base_seq);
+	std::array<uint8_t, DELTA_MASK_SIZE> mask{};
+	std::string bytes;
+	for (std::size_t i = 0; i < packed.size(); ++i) {
+		if (packed[i] == base[i]) continue;
+		mask[i / 8] |= 1 << (i % 8);
+		bytes.push_back(packed[i]);
+	}
+	for (uint8_t b : mask) {
+		w.write(b);
+	}
+	msg += bytes;
+	return msg;
+}
+
+std::string multiplayer::encode_heartbeat(uint16_t seq) {
+	std::string msg;
+	byte_writer w(msg);
+	w.write(uint8_t(UPDATE_HEARTBEAT));
+	w.write(seq);
+	return msg;
+}
+
+std::optional<multiplayer::update_kind> multiplayer::apply_update(const std::string& update, uint16_t& seq, std::string& state) {
+	byte_reader r(update.data(), update.size());
+	uint8_t kind	 = r.read<uint8_t>();
+	uint16_t new_seq = r.read<uint16_t>();
+	if (r.failed()) return {};
+
+	std::string next;
+	switch (kind) {
+	case UPDATE_KEYFRAME:
+		if (r.remaining() != player_state::PACKED_SIZE) return {};
+		next = update.substr(3);
+		break;
+	case UPDATE_DELTA: {
+		uint16_t base = r.read<uint16_t>();
+		if (r.failed() || r.remaining() < DELTA_MASK_SIZE) return {};
+		if (state.size() != player_state::PACKED_SIZE || base != seq) return {};
+		next			   = state;
+		const char* mask   = update.data() + 5;
+		std::size_t at	   = 5 + DELTA_MASK_SIZE;
+		for (std::size_t i = 0; i < player_state::PACKED_SIZE; ++i) {
+			if ((mask[i / 8] & (1 << (i % 8))) == 0) continue;
+			if (at >= update.size()) return {};
+			next[i] = update[at++];
+		}
+		if (at != update.size()) return {};
+		break;
+	}
+	case UPDATE_HEARTBEAT:
+		if (r.remaining() != 0 || state.empty() || new_seq != seq) return {};
+		return UPDATE_HEARTBEAT;
+	default:
+		return {};
+	}
+	if (uint8_t(next[0]) != player_state::VERSION) return {};
+
+	seq	  = new_seq;
+	state = std::move(next);
+	return update_kind(kind);
+}
+
 multiplayer::multiplayer()
 	: m_chat_open(false),
 	  m_players_open(false),
+	  m_view(0, 0, 0, 0),
+	  m_relevance_stale(true),
+	  m_frame(0),
 	  m_room({}),
+	  m_state_seq(0),
+	  m_state_resync(false),
+	  m_clock_offset(0),
+	  m_clock_rtt(0),
+	  m_next_clock_sync(0),
+	  m_sent_bytes(0),
+	  m_recv_bytes(0),
+	  m_sent_updates(0),
+	  m_recv_updates(0),
+	  m_rate_sent_start(0),
+	  m_rate_recv_start(0),
+	  m_sent_rate(0),
+	  m_recv_rate(0),
 	  m_state(state::DISCONNECTED),
 	  m_mp_token({}) {
-	m_h.set_open_listener(std::bind(&multiplayer::m_on_open, this));
-	m_h.set_close_listener(std::bind(&multiplayer::m_on_close, this));
-	m_h.set_fail_listener(std::bind(&multiplayer::m_on_fail, this));
+	if (auto cfg = loopback_transport::config::from_env()) {
+		debug::log() << "multiplayer is running over a simulated loopback link\n";
+		m_h = std::make_unique<loopback_transport>(*cfg);
+	} else {
+		m_h = std::make_unique<sio_transport>();
+	}
+	m_h->set_open_listener(std::bind(&multiplayer::m_on_open, this));
+	m_h->set_close_listener(std::bind(&multiplayer::m_on_close, this));
+	m_h->set_fail_listener(std::bind(&multiplayer::m_on_fail, this));
 
 	// default player icon
 	m_player_renders[-1] = std::make_shared<player_icon>(sf::Color::White, sf::Color::Black);
@@ -62,11 +189,7 @@ multiplayer::multiplayer()
 void multiplayer::draw(sf::RenderTarget& t, sf::RenderStates s) const {
 	if (!auth::get().authed()) return;
 	s.transform *= getTransform();
-	const int me = auth::get().id();
-	for (auto& [uid, p] : m_player_chars) {
-		if (uid == me) continue;
-		t.draw(*p, s);
-	}
+	t.draw(m_ghost_batch, s);
 }
 
 void multiplayer::m_on_open() {
@@ -89,43 +212,72 @@ void multiplayer::connect() {
 	if (m_token_handle.fetching()) return;
 	if (!auth::get().authed()) return;
 	m_state = state::CONNECTING;
+	if (!m_h->needs_token()) {
+		m_open_socket();
+		return;
+	}
 	m_token_handle.reset(api::get().fetch_multiplayer_token());
 }
 
+void multiplayer::m_open_socket() {
+	if (m_connect_handle.fetching()) return;
+	m_connect_handle.reset(std::async([this]() -> bool {
+		m_h->connect(settings::get().server_url());
+		return m_h->opened();
+	}));
+}
+
 void multiplayer::disconnect() {
-	m_h.close();
+	m_h->close();
 	m_state	   = state::DISCONNECTED;
 	m_mp_token = {};
+	m_clear_events();
 	m_player_data.clear();
 	m_player_state.clear();
 	m_player_renders.clear();
 	m_player_chars.clear();
+	m_ghost_tier.clear();
+	m_ghost_batch.clear();
 	m_room = {};
+	m_last_sent.clear();
+	m_interest_sent = {};
+	m_reset_clock();
 }
 
 void multiplayer::join(int level_id) {
 	if (!ready()) return;
 	if (m_room.has_value()) return;
-	m_h.socket()->emit("join", sio::int_message::create(level_id));
+	m_h->emit("join", sio::int_message::create(level_id));
 	debug::log() << "joining room " << level_id << "\n";
 	// m_room = std::to_string(level_id);
 }
 
 void multiplayer::leave() {
-	m_h.socket()->emit("leave");
+	m_h->emit("leave");
+	m_clear_events();
 	m_player_data.clear();
 	m_player_state.clear();
 	m_player_renders.clear();
 	m_player_chars.clear();
 
+	m_ghost_tier.clear();
+	m_ghost_batch.clear();
+
 	m_room		= {};
 	m_chat_open = false;
+	m_last_sent.clear();
+	m_interest_sent = {};
 }
 
 void multiplayer::emit_state(const player_state& state) {
 	m_last_state = state;
 }
 
+void multiplayer::set_view(sf::FloatRect view, std::optional<sf::Vector2f> focus) {
+	m_view	= view;
+	m_focus = focus;
+}
+
 std::unordered_map<int, multiplayer::player_state> multiplayer::get_states() const {
 	return m_player_state;
 }
@@ -139,9 +291,18 @@ void multiplayer::update() {
 		disconnect();
 	}
 
-	if (ready() && auth::get().authed() && m_room.has_value() && m_state_clock.getElapsedTime() > m_state_update_interval) {
-		m_h.socket()->emit("state_update", m_last_state.to_message());
-		m_state_clock.restart();
+	if (ready() && auth::get().authed() && m_room.has_value()) {
+		m_send_state();
+	}
+
+	if (m_rate_clock.getElapsedTime() >= sf::seconds(1)) {
+		float secs		  = m_rate_clock.restart().asSeconds();
+		uint64_t sent	  = m_sent_bytes;
+		uint64_t recv	  = m_recv_bytes;
+		m_sent_rate		  = (sent - m_rate_sent_start) / secs;
+		m_recv_rate		  = (recv - m_rate_recv_start) / secs;
+		m_rate_sent_start = sent;
+		m_rate_recv_start = recv;
 	}
 
 	m_token_handle.poll();
@@ -150,94 +311,217 @@ void multiplayer::update() {
 		m_mp_token = res.token;
 		if (m_mp_token.has_value()) {
 			m_token_handle.reset();
-			if (!m_sio_connect_handle.fetching()) {
-				m_sio_connect_handle.reset(std::async([this]() -> bool {
-					m_h.connect(settings::get().server_url());
-					return m_h.opened();
-				}));
-			}
+			m_open_socket();
 		}
 	}
 
-	m_sio_connect_handle.poll();
-	if (m_sio_connect_handle.ready() && !m_sio_connect_handle.fetching()) {
-		m_sio_connect_handle.reset();
+	m_connect_handle.poll();
+	if (m_connect_handle.ready() && !m_connect_handle.fetching()) {
+		m_connect_handle.reset();
 
 		m_configure_socket_listeners();
 
 		// authenticate
 		auto ptr				= sio::object_message::create();
-		ptr->get_map()["token"] = sio::string_message::create(m_mp_token.value());
+		ptr->get_map()["token"] = sio::string_message::create(m_mp_token.value_or(""));
 		ptr->get_map()["id"]	= sio::int_message::create(auth::get().id());
-		m_h.socket()->emit("authenticate", ptr);
+		m_h->emit("authenticate", ptr);
 	}
 
-	if (!m_player_data_queue.empty()) {
-		std::scoped_lock<std::mutex> lock(m_player_data_queue_mutex);
-		for (auto& data : m_player_data_queue) {
-			m_player_renders[data.id].reset(new player_icon(data.fill, data.outline));
-		}
-		m_player_data_queue.clear();
+	if (ready()) {
+		m_sync_clock();
 	}
 
-	if (!m_player_state_flush_list.empty()) {
-		std::scoped_lock<std::mutex> lock(m_player_state_flush_list_mutex);
-		for (auto& id : m_player_state_flush_list) {
-			if (!m_player_chars.contains(id)) {
-				m_player_chars[id].reset(new player_ghost());
-			}
-			m_player_chars[id]->flush_data(m_get_player_data_or_default(id));
-			m_player_chars[id]->flush_state(m_get_player_state_or_default(id));
-		}
-		m_player_state_flush_list.clear();
+	m_h->poll();
+	event ev;
+	while (m_events.pop(ev)) {
+		m_handle_event(ev);
 	}
 
-	if (!m_player_erase_queue.empty()) {
-		std::scoped_lock<std::mutex> lock(m_player_erase_queue_mutex);
-		for (auto& id : m_player_erase_queue) {
-			m_player_data.erase(id);
-			m_player_state.erase(id);
-			m_player_state_flush_list.erase(id);
-			m_player_chars.erase(id);
-			m_player_renders.erase(id);
-		}
-		m_player_erase_queue.clear();
+	if (m_relevance_stale || m_relevance_clock.getElapsedTime() >= m_relevance_interval) {
+		m_update_relevance();
 	}
+	if (ready() && m_room.has_value()) {
+		m_send_interest();
+	}
+
+	m_frame++;
+	// a state's trip here is their hop up to the server & our hop down, about one of our round trips
+	for (auto& [uid, tier] : m_ghost_tier) {
+		// staggered by id, so a tier's ghosts don't all land on the same frame
+		if ((m_frame + uid) % (1 << tier) != 0) continue;
+		m_player_chars.at(uid)->update(sf::milliseconds(m_clock_rtt));
+	}
+
+	m_ghost_batch.clear();
+	for (auto& [uid, tier] : m_ghost_tier) {
+		m_player_chars.at(uid)->batch(m_ghost_batch);
+	}
+}
+
+sf::Vector2f multiplayer::m_focus_or_center() const {
+	if (m_focus) return *m_focus;
+	return { m_view.left + m_view.width / 2.f, m_view.top + m_view.height / 2.f };
+}
+
+void multiplayer::m_update_relevance() {
+	m_relevance_clock.restart();
+	m_relevance_stale = false;
+	m_ghost_tier.clear();
 
+	const int me	   = auth::get().id();
+	sf::Vector2f focus = m_focus_or_center();
+	// a tile of slack, so ghosts half over the edge still show
+	sf::FloatRect view(m_view.left - 1, m_view.top - 1, m_view.width + 2, m_view.height + 2);
+	std::vector<std::pair<float, int>> visible;
 	for (auto& [uid, p] : m_player_chars) {
-		p->update();
+		if (uid == me) continue;
+		sf::Vector2f pos = p->latest_position();
+		if (!view.contains(pos)) continue;
+		visible.push_back({ std::hypot(pos.x - focus.x, pos.y - focus.y), uid });
+	}
+
+	std::size_t keep = std::min(visible.size(), MAX_VISIBLE_GHOSTS);
+	std::partial_sort(visible.begin(), visible.begin() + keep, visible.end());
+	for (std::size_t i = 0; i < keep; ++i) {
+		auto [dist, uid] = visible[i];
+		int tier		 = 2;
+		if (dist < NEAR_DISTANCE) {
+			tier = 0;
+		} else if (dist < MID_DISTANCE) {
+			tier = 1;
+		}
+		m_ghost_tier[uid] = tier;
 	}
 }
 
+void multiplayer::m_send_interest() {
+	sf::Vector2f focus = m_focus_or_center();
+	if (m_interest_sent && std::hypot(focus.x - m_interest_sent->x, focus.y - m_interest_sent->y) < NEAR_DISTANCE / 2.f) return;
+	if (m_interest_sent && m_interest_clock.getElapsedTime() < m_relevance_interval) return;
+	m_interest_clock.restart();
+	m_interest_sent = focus;
+
+	// the server sends the nearest players' states every flush, everyone else's less often
+	auto hint			   = sio::object_message::create();
+	hint->get_map()["x"]   = sio::double_message::create(focus.x);
+	hint->get_map()["y"]   = sio::double_message::create(focus.y);
+	hint->get_map()["max"] = sio::int_message::create(MAX_VISIBLE_GHOSTS);
+	m_h->emit("interest", hint);
+}
+
+void multiplayer::m_sync_clock() {
+	uint64_t now = util::get_time();
+	if (now < m_next_clock_sync) return;
+	sf::Time interval = m_clock_samples.size() < CLOCK_SAMPLES ? m_clock_burst_interval : m_clock_sync_interval;
+	m_next_clock_sync = now + interval.asMilliseconds();
+	m_h->emit("clock_sync", sio::int_message::create(now));
+}
+
+void multiplayer::m_add_clock_sample(const std::array<uint64_t, 4>& times) {
+	auto [sent, received, replied, arrived] = times;
+	// the server read its clock halfway along the round trip, not counting however long it held on to the request
+	int64_t rtt	   = (int64_t(arrived) - int64_t(sent)) - (int64_t(replied) - int64_t(received));
+	int64_t offset = ((int64_t(received) - int64_t(sent)) + (int64_t(replied) - int64_t(arrived))) / 2;
+	m_clock_samples.push(clock_sample{ .offset = offset, .rtt = std::max<int64_t>(rtt, 0) });
+
+	// queueing only ever adds delay, and rarely the same amount both ways, so the quickest recent round trip
+	// gives the truest offset
+	const clock_sample* best = &m_clock_samples[0];
+	for (std::size_t i = 1; i < m_clock_samples.size(); ++i) {
+		if (m_clock_samples[i].rtt < best->rtt) best = &m_clock_samples[i];
+	}
+	m_clock_offset = best->offset;
+	m_clock_rtt	   = best->rtt;
+}
+
+void multiplayer::m_reset_clock() {
+	m_clock_samples.clear();
+	m_clock_offset	  = 0;
+	m_clock_rtt		  = 0;
+	m_next_clock_sync = 0;
+}
+
+uint64_t multiplayer::m_to_server_time(uint64_t local) const {
+	return local + m_clock_offset;
+}
+
+uint64_t multiplayer::m_to_local_time(uint64_t server) const {
+	return server - m_clock_offset;
+}
+
+void multiplayer::m_send_state() {
+	// stamped with the server's clock, which every receiver knows their own offset from
+	player_state stamped = m_last_state;
+	stamped.updatedAt	 = m_to_server_time(stamped.updatedAt);
+	std::string packed	 = stamped.pack();
+	bool keyframe		 = m_last_sent.empty() || m_state_resync;
+	bool changed		 = keyframe || !player_state::same_packed(packed, m_last_sent);
+	bool moving			 = m_last_state.controls.xv != 0 || m_last_state.controls.yv != 0;
+	sf::Time interval	 = moving ? m_state_moving_interval : m_state_update_interval;
+	if (!changed) interval = m_state_heartbeat_interval;
+	if (m_state_clock.getElapsedTime() < interval) return;
+	m_state_clock.restart();
+
+	std::string msg;
+	if (keyframe) {
+		m_state_resync = false;
+		msg			   = encode_keyframe(++m_state_seq, packed);
+	} else if (!changed) {
+		msg = encode_heartbeat(m_state_seq);
+	} else {
+		msg = encode_delta(m_state_seq, m_last_sent, packed);
+		++m_state_seq;
+	}
+	if (changed) m_last_sent = std::move(packed);
+
+	m_sent_bytes += msg.size();
+	m_sent_updates++;
+	m_h->emit("state_update", sio::binary_message::create(std::make_shared<const std::string>(std::move(msg))));
+}
+
+multiplayer::net_stats multiplayer::get_net_stats() const {
+	return net_stats{
+		.sent_bytes	  = m_sent_bytes,
+		.recv_bytes	  = m_recv_bytes,
+		.sent_updates = m_sent_updates,
+		.recv_updates = m_recv_updates,
+		.sent_rate	  = m_sent_rate,
+		.recv_rate	  = m_recv_rate,
+		.rtt		  = m_clock_rtt,
+		.clock_offset = m_clock_offset,
+	};
+}
+
 nametag& multiplayer::get_self_tag() {
 	return m_self_tag;
 }
 
 void multiplayer::m_configure_socket_listeners() {
-	m_h.socket()->off_all();
+	m_h->off_all();
 
 	// error handling
-	m_h.socket()->on("connection_error", [this](sio::event& ev) {
-		debug::log() << "socket connect error: " << ev.get_message()->get_string() << "\n";
-		disconnect();
+	m_h->on("connection_error", [this](const sio::message::ptr& msg) {
+		debug::log() << "socket connect error: " << msg->get_string() << "\n";
+		m_push_event(event{ .kind = event::FAILED });
 	});
-	m_h.socket()->on("warn", [this](sio::event& ev) {
-		debug::log() << "socket warning: " << ev.get_message()->get_string() << "\n";
+	m_h->on("warn", [this](const sio::message::ptr& msg) {
+		debug::log() << "socket warning: " << msg->get_string() << "\n";
 	});
-	m_h.socket()->on("error", [this](sio::event& ev) {
-		debug::log() << "socket error: " << ev.get_message()->get_string() << "\n";
-		disconnect();
+	m_h->on("error", [this](const sio::message::ptr& msg) {
+		debug::log() << "socket error: " << msg->get_string() << "\n";
+		m_push_event(event{ .kind = event::FAILED });
 	});
-	m_h.socket()->on_error([this](const std::shared_ptr<sio::message>& err) {
+	m_h->on_error([this](const sio::message::ptr& err) {
 		debug::log() << "socket error"
 					 << "\n";
-		disconnect();
+		m_push_event(event{ .kind = event::FAILED });
 	});
 
 	// joining and leaving (called when we do it too)
-	m_h.socket()->on("joined", [this](sio::event& ev) {
+	m_h->on("joined", [this](const sio::message::ptr& msg) {
 		// player data
-		auto data = ev.get_message()->get_map();
+		auto data = msg->get_map();
 		int id	  = data["id"]->get_int();
 		player_data d;
 		d.id	  = id;
@@ -246,50 +530,19 @@ void multiplayer::m_configure_socket_listeners() {
 		d.outline = sf::Color(data["outline"]->get_int());
 		debug::log() << "[joined] " << d.name << "#" << d.id << "\n";
 
-		m_update_player_data(d);
-		m_update_player_state(player_state::empty(d.id));
-
-		chat_message join_msg;
-		join_msg.authorId  = -2;
-		join_msg.color	   = sf::Color(0x77dd77ff);
-		join_msg.createdAt = std::time(nullptr);
-		join_msg.text	   = "[+] " + d.name + " joined room #" + data["room"]->get_string() + "!";
-		m_chat_messages.push_back(join_msg);
-
-		// if it was us, update the room we're in
-		if (d.id == auth::get().id()) {
-			m_room = data["room"]->get_string();
-			// also update our nametag
-			m_self_tag.set_name(auth::get().username());
-		}
+		m_push_event(event{ .kind = event::JOINED, .id = d.id, .data = d, .room = data["room"]->get_string() });
 	});
-	m_h.socket()->on("left", [this](sio::event& ev) {
+	m_h->on("left", [this](const sio::message::ptr& msg) {
 		// player id
-		int id = ev.get_message()->get_int();
-
-		if (m_player_data.contains(id)) {
-			chat_message leave_msg;
-			leave_msg.authorId	= -2;
-			leave_msg.color		= sf::Color(0xff6961ff);
-			leave_msg.createdAt = std::time(nullptr);
-			leave_msg.text		= "[-] " + m_player_data.at(id).name + " left room #" + m_room.value() + ".";
-			m_chat_messages.push_back(leave_msg);
-		}
-
-		m_remove_player(id);
-
-		// if it was us, update the room we're in
-		if (id == auth::get().id()) {
-			m_room = {};
-		}
+		m_push_event(event{ .kind = event::LEFT, .id = int(msg->get_int()) });
 	});
 
 	// game state
-	m_h.socket()->on("data_update", [this](sio::event& ev) {
-		auto msgs = ev.get_message()->get_vector();
-		debug::log() << "[data_update] sz:" << msgs.size() << "\n";
-		for (auto& msg : msgs) {
-			auto data = msg->get_map();
+	m_h->on("data_update", [this](const sio::message::ptr& msg) {
+		auto players = msg->get_vector();
+		debug::log() << "[data_update] sz:" << players.size() << "\n";
+		for (auto& player : players) {
+			auto data = player->get_map();
 			int id	  = data["id"]->get_int();
 			player_data d;
 			d.id	  = id;
@@ -297,39 +550,60 @@ void multiplayer::m_configure_socket_listeners() {
 			d.fill	  = sf::Color(data["fill"]->get_int());
 			d.outline = sf::Color(data["outline"]->get_int());
 
-			m_update_player_data(d);
+			m_push_event(event{ .kind = event::DATA, .id = d.id, .data = d });
 		}
 	});
-	m_h.socket()->on("state_update", [this](sio::event& ev) {
-		auto msgs = ev.get_message()->get_vector();
-		for (auto& msg : msgs) {
-			player_state st = player_state::from_message(msg);
-			if (!m_player_data.contains(st.id)) continue;	// ignore deleted players
-			m_update_player_state(st);
+	m_h->on("state_update", [this](const sio::message::ptr& msg) {
+		// every player's packed state, back to back
+		if (!msg || msg->get_flag() != sio::message::flag_binary) return;
+		auto& bin = msg->get_binary();
+		m_recv_bytes += bin->size();
+		m_recv_updates++;
+		byte_reader r(bin->data(), bin->size());
+		while (r.remaining() >= player_state::PACKED_SIZE) {
+			auto st = player_state::unpack(r);
+			if (!st) {
+				debug::log() << "dropping state_update from an incompatible version\n";
+				return;
+			}
+			m_push_event(event{ .kind = event::STATE, .id = st->id, .state = std::move(*st) });
 		}
 	});
+	m_h->on("state_resync", [this](const sio::message::ptr& msg) {
+		// the server doesn't have the state our deltas are based on
+		m_state_resync = true;
+	});
+
+	// clock sync, the server's reply to m_sync_clock
+	m_h->on("clock_sync", [this](const sio::message::ptr& msg) {
+		uint64_t arrived = util::get_time();
+		if (!msg || msg->get_flag() != sio::message::flag_object) return;
+		auto data = msg->get_map();
+		if (!data.contains("sent") || !data.contains("received") || !data.contains("replied")) return;
+		std::array<uint64_t, 4> times = { uint64_t(data["sent"]->get_int()), uint64_t(data["received"]->get_int()), uint64_t(data["replied"]->get_int()), arrived };
+		m_push_event(event{ .kind = event::CLOCK, .times = times });
+	});
 
 	// chat
-	m_h.socket()->on("chat", [this](sio::event& ev) {
-		auto data = ev.get_message()->get_map();
-		chat_message msg;
-		msg.text	  = data["text"]->get_string();
-		msg.authorId  = data["authorId"]->get_int();
-		msg.createdAt = data["createdAt"]->get_int();
-		msg.color	  = sf::Color::White;
-
-		m_chat_messages.push_back(msg);
+	m_h->on("chat", [this](const sio::message::ptr& msg) {
+		auto data = msg->get_map();
+		chat_message chat;
+		chat.text	   = data["text"]->get_string();
+		chat.authorId  = data["authorId"]->get_int();
+		chat.createdAt = data["createdAt"]->get_int();
+		chat.color	   = sf::Color::White;
+
+		m_push_event(event{ .kind = event::CHAT, .id = chat.authorId, .chat = chat });
 	});
 
 	// auth
-	m_h.socket()->on("authorized", [this](sio::event& ev) {
+	m_h->on("authorized", [this](const sio::message::ptr& msg) {
 		debug::log() << "socket authenticated\n";
 		m_state = state::CONNECTED;
 	});
 
-	m_h.socket()->on("unauthorized", [this](sio::event& ev) {
-		debug::log() << "socket not valid\n";
-		disconnect();
+	m_h->on("unauthorized", [this](const sio::message::ptr& msg) {
+		m_push_event(event{ .kind = event::UNAUTHORIZED });
 	});
 }
 
@@ -346,22 +620,120 @@ multiplayer::player_data multiplayer::m_get_player_data_or_default(int uid) cons
 	}
 }
 
-multiplayer::player_state multiplayer::m_get_player_state_or_default(int uid) const {
-	if (m_player_state.contains(uid)) {
-		return m_player_state.at(uid);
-	} else {
-		player_state d = player_state::empty(uid);
-		d.id		   = uid;
-		d.updatedAt	   = util::get_time();
-		return d;
+void multiplayer::m_push_event(event&& ev) {
+	// a stalled game loop can't have states pile up, the ghosts only care about the newest few anyway
+	if (ev.kind == event::STATE) {
+		m_events.push(std::move(ev));
+		return;
+	}
+	// anything else would leave the game out of sync, hold the socket up until there's room
+	while (!m_events.push(std::move(ev))) {
+		std::this_thread::yield();
+	}
+}
+
+void multiplayer::m_clear_events() {
+	event ev;
+	while (m_events.pop(ev)) { }
+}
+
+void multiplayer::m_handle_event(event& ev) {
+	switch (ev.kind) {
+	case event::JOINED: {
+		m_update_player_data(ev.data);
+		m_add_player(ev.id);
+
+		chat_message join_msg;
+		join_msg.authorId  = -2;
+		join_msg.color	   = sf::Color(0x77dd77ff);
+		join_msg.createdAt = std::time(nullptr);
+		join_msg.text	   = "[+] " + ev.data.name + " joined room #" + ev.room + "!";
+		m_push_chat(join_msg);
+
+		// if it was us, update the room we're in
+		if (ev.id == auth::get().id()) {
+			m_room		   = ev.room;
+			m_state_resync = true;
+			// also update our nametag
+			m_self_tag.set_name(auth::get().username());
+		}
+		break;
+	}
+	case event::LEFT:
+		if (m_player_data.contains(ev.id) && m_room.has_value()) {
+			chat_message leave_msg;
+			leave_msg.authorId	= -2;
+			leave_msg.color		= sf::Color(0xff6961ff);
+			leave_msg.createdAt = std::time(nullptr);
+			leave_msg.text		= "[-] " + m_player_data.at(ev.id).name + " left room #" + m_room.value() + ".";
+			m_push_chat(leave_msg);
+		}
+
+		m_remove_player(ev.id);
+
+		// if it was us, update the room we're in
+		if (ev.id == auth::get().id()) {
+			m_room = {};
+		}
+		break;
+	case event::DATA:
+		m_update_player_data(ev.data);
+		break;
+	case event::STATE:
+		if (!m_player_data.contains(ev.id)) break;	 // ignore deleted players
+		ev.state.updatedAt = m_to_local_time(ev.state.updatedAt);
+		m_update_player_state(ev.state);
+		break;
+	case event::CHAT:
+		m_push_chat(ev.chat);
+		break;
+	case event::CLOCK:
+		m_add_clock_sample(ev.times);
+		break;
+	case event::FAILED:
+		disconnect();
+		break;
+	case event::UNAUTHORIZED:
+		debug::log() << "socket not valid\n";
+		disconnect();
+		break;
 	}
 }
 
+uint8_t multiplayer::m_intern_color(sf::Color color) {
+	auto it = std::find(m_chat_colors.begin(), m_chat_colors.end(), color);
+	if (it != m_chat_colors.end()) return it - m_chat_colors.begin();
+	// there's never more than a few, but if there were, the rest fall back to the first one seen
+	if (m_chat_colors.size() > UINT8_MAX) return 0;
+	m_chat_colors.push_back(color);
+	return m_chat_colors.size() - 1;
+}
+
+void multiplayer::m_push_chat(const chat_message& msg) {
+	m_chat.push(chat_line{
+		.text	   = msg.text,
+		.authorId  = msg.authorId,
+		.createdAt = msg.createdAt,
+		.color	   = m_intern_color(msg.color),
+	});
+}
+
 void multiplayer::m_update_player_state(const player_state& state) {
 	m_player_state[state.id] = state;
+	m_add_player(state.id);
+	m_player_chars[state.id]->flush_state(state);
+}
 
-	std::scoped_lock<std::mutex> lock(m_player_state_flush_list_mutex);
-	m_player_state_flush_list.insert(state.id);
+void multiplayer::m_add_player(int id) {
+	if (!m_player_state.contains(id)) {
+		// the placeholder isn't anywhere they've really been, so it stays out of the ghost's buffer
+		m_player_state[id] = player_state::empty(id);
+	}
+	if (!m_player_chars.contains(id)) {
+		m_player_chars[id].reset(new player_ghost());
+		m_player_chars[id]->flush_data(m_get_player_data_or_default(id));
+		m_relevance_stale = true;
+	}
 }
 
 void multiplayer::m_update_player_data(const player_data& data) {
@@ -369,13 +741,18 @@ void multiplayer::m_update_player_data(const player_data& data) {
 
 	debug::log() << "updating player data for " << data.id << "\n";
 
-	std::scoped_lock<std::mutex> lock(m_player_data_queue_mutex);
-	m_player_data_queue.push_back(data);
+	m_player_renders[data.id].reset(new player_icon(data.fill, data.outline));
+	if (m_player_chars.contains(data.id)) {
+		m_player_chars[data.id]->flush_data(data);
+	}
 }
 
 void multiplayer::m_remove_player(int id) {
-	std::scoped_lock<std::mutex> lock(m_player_erase_queue_mutex);
-	m_player_erase_queue.push_back(id);
+	m_player_data.erase(id);
+	m_player_state.erase(id);
+	m_player_chars.erase(id);
+	m_player_renders.erase(id);
+	m_ghost_tier.erase(id);
 }
 
 void multiplayer::imdraw() {
@@ -392,28 +769,36 @@ void multiplayer::imdraw() {
 		ImGui::SetNextWindowSize(ImVec2(500, 400), ImGuiCond_FirstUseEver);
 		ImGui::Begin(chat_title.c_str(), &m_chat_open);
 		ImGui::BeginChild("ChatScrolling###ChatScrolling", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), false, ImGuiWindowFlags_HorizontalScrollbar);
-		int i = 0;
-		for (auto& msg : m_chat_messages) {
-			ImGui::PushID(i);
-			if (m_player_renders.contains(msg.authorId)) {
-				m_player_renders.at(msg.authorId)->imdraw(16, 16);
-				ImGui::SameLine();
-			} else if (msg.authorId != -2) {
-				m_player_renders.at(-1)->imdraw(16, 16);
-				ImGui::SameLine();
+		// only the lines in view are submitted, which needs every line the same height. so no wrapping, and
+		// system messages get an empty icon-high spacer where the icon would go
+		ImGuiListClipper clipper;
+		clipper.Begin(m_chat.size());
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				const chat_line& msg = m_chat[i];
+				ImGui::PushID(i);
+				if (m_player_renders.contains(msg.authorId)) {
+					m_player_renders.at(msg.authorId)->imdraw(16, 16);
+					ImGui::SameLine();
+				} else if (msg.authorId != -2) {
+					m_player_renders.at(-1)->imdraw(16, 16);
+					ImGui::SameLine();
+				} else {
+					ImGui::Dummy(ImVec2(0, 16));
+					ImGui::SameLine(0, 0);
+				}
+				ImGui::PushStyleColor(ImGuiCol_Text, m_chat_colors[msg.color]);
+				ImGui::TextUnformatted(msg.text.c_str(), msg.text.c_str() + msg.text.size());
+				ImGui::PopStyleColor();
+				ImGui::PopID();
 			}
-			ImGui::PushStyleColor(ImGuiCol_Text, msg.color);
-			ImGui::TextWrapped("%s", msg.text.c_str());
-			ImGui::PopStyleColor();
-			ImGui::PopID();
-			i++;
 		}
 		ImGui::EndChild();
 		ImGui::Separator();
 		ImGui::PushItemWidth(-1);
 		if (ImGui::InputText("ChatInput", m_chat_input, 256, ImGuiInputTextFlags_EnterReturnsTrue)) {
 			if (m_chat_input[0]) {
-				m_h.socket()->emit("chat", sio::string_message::create(m_chat_input));
+				m_h->emit("chat", sio::string_message::create(m_chat_input));
 				m_chat_input[0] = 0;
 			}
 			ImGui::SetKeyboardFocusHere(-1);
@@ -1,8 +1,11 @@
 #pragma once
 
-#include <set>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <memory>
 #include <vector>
-#include "sio_client.h"
 
 #include <imgui-SFML.h>
 #include <imgui.h>
@@ -11,8 +14,13 @@
 #include "api.hpp"
 #include "api_handle.hpp"
 #include "auth.hpp"
+#include "ghost_batch.hpp"
+#include "mp_transport.hpp"
 #include "nametag.hpp"
+#include "net_buffer.hpp"
+#include "ring_buffer.hpp"
 #include "settings.hpp"
+#include "spsc_ring.hpp"
 #include "world.hpp"
 
 class player_ghost;
@@ -42,9 +50,33 @@ public:
 		std::string anim = "stand";
 		uint64_t updatedAt;
 		static player_state empty(int id);
-		sio::message::ptr to_message() const;
-		static player_state from_message(const sio::message::ptr& msg);
+
+		// binary state_update layout, bump the version whenever it changes
+		static constexpr uint8_t VERSION		 = 1;
+		static constexpr std::size_t PACKED_SIZE = 1 + 4 + 8 + world::control_vars::PACKED_SIZE + 1;
+		std::string pack() const;
+		// empty if the version doesn't match or the data's cut short
+		static std::optional<player_state> unpack(byte_reader& r);
+		// do two packed states differ by anything but when they were taken
+		static bool same_packed(const std::string& a, const std::string& b);
+	};
+
+	// kinds of outgoing state_update, each starts with the kind & a u16 sequence number
+	enum update_kind : uint8_t {
+		UPDATE_KEYFRAME	 = 0,	// the whole packed state
+		UPDATE_DELTA	 = 1,	// u16 sequence it's based on, a bitmask of the bytes that changed, then those bytes
+		UPDATE_HEARTBEAT = 2,	// nothing changed, the sequence is the state the server should still have
 	};
+	static constexpr std::size_t DELTA_MASK_SIZE = (player_state::PACKED_SIZE + 7) / 8;
+	// the whole packed state, as the new state numbered seq
+	static std::string encode_keyframe(uint16_t seq, const std::string& packed);
+	// the bytes of packed that differ from base, as the state after base_seq
+	static std::string encode_delta(uint16_t base_seq, const std::string& base, const std::string& packed);
+	// no change since the state numbered seq
+	static std::string encode_heartbeat(uint16_t seq);
+	// apply an update onto a stored packed state & its sequence number, leaving them as they were if it's malformed,
+	// of another version, or based on a state other than the stored one. empty state means nothing's stored yet
+	static std::optional<update_kind> apply_update(const std::string& update, uint16_t& seq, std::string& state);
 
 	struct chat_message {
 		std::string text;
@@ -77,10 +109,27 @@ public:
 
 	// id field is ignored
 	void emit_state(const player_state& state);
+	// what's on screen & where the local player is, in tiles. ghosts out of view, or past the nearest few,
+	// aren't drawn or updated, and the rest update less often the further they are from the focus.
+	// with no focus (i.e. editing) distances are from the middle of the view
+	void set_view(sf::FloatRect view, std::optional<sf::Vector2f> focus = {});
 	std::unordered_map<int, player_state> get_states() const;
 
 	nametag& get_self_tag();
 
+	// running totals for gauging multiplayer bandwidth
+	struct net_stats {
+		uint64_t sent_bytes;	 // state update bytes sent
+		uint64_t recv_bytes;	 // state update bytes received
+		uint64_t sent_updates;	 // state updates sent, heartbeats included
+		uint64_t recv_updates;	 // state updates received
+		float sent_rate;		 // bytes per second sent over the last second
+		float recv_rate;		 // bytes per second received over the last second
+		int64_t rtt;			 // round trip to the server, in ms
+		int64_t clock_offset;	 // the server's clock minus ours, in ms
+	};
+	net_stats get_net_stats() const;
+
 private:
 	multiplayer();
 	multiplayer(const multiplayer& other) = delete;
@@ -94,49 +143,130 @@ private:
 
 	void m_configure_socket_listeners();
 
-	void m_remove_player(int id);
-
 	bool m_chat_open;
 	bool m_players_open;
 
-	const sf::Time m_state_update_interval = sf::milliseconds(50);
+	// players on the move are sent more often, idle ones only let the server know they're still there
+	const sf::Time m_state_moving_interval	  = sf::milliseconds(50);
+	const sf::Time m_state_update_interval	  = sf::milliseconds(100);
+	const sf::Time m_state_heartbeat_interval = sf::seconds(1);
+
+	// interest management. ghosts within NEAR_DISTANCE tiles update every frame, within MID_DISTANCE every
+	// other frame, and every fourth frame past that
+	static constexpr std::size_t MAX_VISIBLE_GHOSTS = 16;
+	static constexpr float NEAR_DISTANCE			= 8.f;
+	static constexpr float MID_DISTANCE				= 16.f;
+	const sf::Time m_relevance_interval				= sf::milliseconds(250);   // also the most often the server hears where we are
+	sf::FloatRect m_view;
+	std::optional<sf::Vector2f> m_focus;
+	std::unordered_map<int, int> m_ghost_tier;	 // ghosts that are drawn, updated once every 2^tier frames
+	bool m_relevance_stale;						 // ghosts came or went since the last ranking
+	sf::Clock m_relevance_clock;
+	sf::Clock m_interest_clock;
+	std::optional<sf::Vector2f> m_interest_sent;   // focus the server last heard, it's only told again once we move away
+	uint64_t m_frame;
+	sf::Vector2f m_focus_or_center() const;
+	void m_update_relevance();	 // rank the ghosts & pick the ones worth drawing
+	void m_send_interest();		 // tell the server whose states we care about most
 
 	std::optional<std::string> m_room;
 	std::unordered_map<int, player_data> m_player_data;
 	std::unordered_map<int, player_state> m_player_state;
 	player_data m_get_player_data_or_default(int uid) const;
-	player_state m_get_player_state_or_default(int uid) const;
 
 	nametag m_self_tag;
 
-	// rendering contexts created in other threads are invalidated when the thread closes.
-	// we queue up the data updates so that we can generate the player icons when needed
-	std::vector<player_data> m_player_data_queue;
-	// all the uids to flush ghosts for
-	std::set<int> m_player_state_flush_list;
-	// player erase queue
-	std::vector<int> m_player_erase_queue;
-	std::mutex m_player_data_queue_mutex;
-	std::mutex m_player_state_flush_list_mutex;
-	std::mutex m_player_erase_queue_mutex;
+	// what the socket has heard, handed to the game loop to act on. everything the listeners
+	// learn goes through here, so the players, ghosts, chat & room are only ever touched by the game loop
+	struct event {
+		enum kind_t {
+			JOINED,			// data joined room
+			LEFT,			// id left
+			DATA,			// data changed
+			STATE,			// state arrived
+			CHAT,			// chat was sent
+			CLOCK,			// a clock sync reply arrived
+			FAILED,			// the socket errored, disconnect
+			UNAUTHORIZED,	// the server turned our token down, disconnect
+		} kind;
+		int id;
+		player_data data;
+		player_state state;
+		chat_message chat;
+		std::string room;
+		std::array<uint64_t, 4> times;	 // clock sync: sent, received & replied by the server, arrived
+	};
+	static constexpr std::size_t EVENT_CAPACITY = 1024;
+	spsc_ring<event, EVENT_CAPACITY> m_events;
+	void m_push_event(event&& ev);	 // transport listeners only
+	void m_handle_event(event& ev);
+	void m_clear_events();			 // drop whatever's left from the last room
 
 	void m_update_player_state(const player_state& state);
+	void m_add_player(int id);	 // create a player's ghost before their first state arrives
 	void m_update_player_data(const player_data& data);
+	void m_remove_player(int id);
 
 	sf::Clock m_state_clock;
 	player_state m_last_state;
+	std::string m_last_sent;			// packed state the server has for us, deltas are made against it
+	uint16_t m_state_seq;				// sequence number of m_last_sent
+	std::atomic<bool> m_state_resync;	// the server lost track of our state, send all of it next
+	void m_send_state();
+
+	// clock sync, ntp style. states are sent stamped with the server's clock, and translated to ours as they
+	// arrive, so whatever the senders' clocks say, every updatedAt a ghost sees is local time
+	struct clock_sample {
+		int64_t offset;	  // the server's clock minus ours, in ms
+		int64_t rtt;
+	};
+	static constexpr std::size_t CLOCK_SAMPLES = 8;
+	const sf::Time m_clock_burst_interval	   = sf::milliseconds(250);	  // until there's a full window of samples
+	const sf::Time m_clock_sync_interval	   = sf::seconds(5);
+	ring_buffer<clock_sample, CLOCK_SAMPLES> m_clock_samples;
+	int64_t m_clock_offset;		  // from the sample with the quickest round trip
+	int64_t m_clock_rtt;
+	uint64_t m_next_clock_sync;	  // local time to send the next request at, 0 for right away
+	void m_sync_clock();
+	void m_add_clock_sample(const std::array<uint64_t, 4>& times);
+	void m_reset_clock();
+	uint64_t m_to_server_time(uint64_t local) const;
+	uint64_t m_to_local_time(uint64_t server) const;
+
+	std::atomic<uint64_t> m_sent_bytes;
+	std::atomic<uint64_t> m_recv_bytes;
+	std::atomic<uint64_t> m_sent_updates;
+	std::atomic<uint64_t> m_recv_updates;
+	sf::Clock m_rate_clock;
+	uint64_t m_rate_sent_start;	  // byte counts at the start of the current one second window
+	uint64_t m_rate_recv_start;
+	float m_sent_rate;
+	float m_recv_rate;
 
 	std::unordered_map<int, std::shared_ptr<player_icon>> m_player_renders;	  // thumbnail renders of all players
 	std::unordered_map<int, std::shared_ptr<player_ghost>> m_player_chars;	  // gameplay renders of all players
+	ghost_batch m_ghost_batch;												  // the ghosts worth drawing, rebuilt every update
 
 	api_handle<api::multiplayer_token_response> m_token_handle;	  // for fetching the mp token to send to sio
-	api_handle<bool> m_sio_connect_handle;
+	api_handle<bool> m_connect_handle;
+	void m_open_socket();
 
-	std::vector<chat_message> m_chat_messages;
+	// the most recent chat, oldest first. older messages are overwritten rather than kept forever
+	struct chat_line {
+		std::string text;
+		int authorId;
+		std::time_t createdAt;
+		uint8_t color;	 // index into m_chat_colors, messages mostly share a handful
+	};
+	static constexpr std::size_t CHAT_CAPACITY = 256;
+	ring_buffer<chat_line, CHAT_CAPACITY> m_chat;
+	std::vector<sf::Color> m_chat_colors;
+	uint8_t m_intern_color(sf::Color color);
+	void m_push_chat(const chat_message& msg);
 	char m_chat_input[256];
 
-	// sio client
-	sio::client m_h;
-	state m_state;
+	// the socket.io client, or a simulated stand-in for the server (see loopback_transport)
+	std::unique_ptr<mp_transport> m_h;
+	std::atomic<state> m_state;	  // set from the sio thread too
 	std::optional<std::string> m_mp_token;
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+/// appends fixed-width integers to a byte string, little-endian regardless of the host
+class byte_writer {
+public:
+	byte_writer(std::string& out)
+		: m_out(out) {
+	}
+
+	template <typename T>
+	void write(T v) {
+		static_assert(std::is_integral_v<T>, "only integers can be written");
+		using U = std::make_unsigned_t<T>;
+		U u		= static_cast<U>(v);
+		for (std::size_t i = 0; i < sizeof(T); ++i) {
+			m_out.push_back(static_cast<char>((u >> (8 * i)) & 0xff));
+		}
+	}
+
+private:
+	std::string& m_out;
+};
+
+/// reads back what a byte_writer wrote. reading past the end yields zeroes and sets the failed flag
+class byte_reader {
+public:
+	byte_reader(const char* data, std::size_t size)
+		: m_data(reinterpret_cast<const unsigned char*>(data)),
+		  m_size(size),
+		  m_pos(0),
+		  m_failed(false) {
+	}
+
+	template <typename T>
+	T read() {
+		static_assert(std::is_integral_v<T>, "only integers can be read");
+		if (m_pos + sizeof(T) > m_size) {
+			m_failed = true;
+			m_pos	 = m_size;
+			return T(0);
+		}
+		using U = std::make_unsigned_t<T>;
+		U u		= 0;
+		for (std::size_t i = 0; i < sizeof(T); ++i) {
+			u |= static_cast<U>(m_data[m_pos + i]) << (8 * i);
+		}
+		m_pos += sizeof(T);
+		return static_cast<T>(u);
+	}
+
+	std::size_t remaining() const {
+		return m_size - m_pos;
+	}
+
+	bool failed() const {
+		return m_failed;
+	}
+
+private:
+	const unsigned char* m_data;
+	std::size_t m_size;
+	std::size_t m_pos;
+	bool m_failed;
+};
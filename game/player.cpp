@@ -70,6 +70,10 @@ sf::Vector2i player::size() const {
 	return m_inner.size();
 }
 
+sf::IntRect player::frame() const {
+	return m_inner.spr().getTextureRect();
+}
+
 void player::update() {
 	m_inner.animate();
 	m_outer.animate();
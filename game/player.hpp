@@ -22,6 +22,7 @@ public:
 	std::string get_animation() const;
 
 	sf::Vector2i size() const;
+	sf::IntRect frame() const;	 // the current animation frame's rect in the player textures
 
 private:
 	void draw(sf::RenderTarget&, sf::RenderStates) const;	// sfml draw override
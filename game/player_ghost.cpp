@@ -1,69 +1,162 @@
 #include "player_ghost.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include "debug.hpp"
+#include "particles/smoke.hpp"
 #include "replay.hpp"
 #include "util.hpp"
 #include "world.hpp"
 
+const sf::Time player_ghost::RENDER_DELAY	   = sf::milliseconds(100);
+const sf::Time player_ghost::MAX_EXTRAPOLATION = sf::milliseconds(250);
+const sf::Time player_ghost::ERROR_DECAY	   = sf::milliseconds(100);
+
 player_ghost::player_ghost()
-	: m_pmgr(nullptr) {
+	: m_extrapolated(world::control_vars::empty),
+	  m_extrapolated_from(0),
+	  m_extrapolated_for(sf::Time::Zero),
+	  m_extrapolating(false),
+	  m_error(0, 0),
+	  m_display(world::control_vars::empty),
+	  m_anim("stand"),
+	  m_pmgr(nullptr) {
 	m_last_update = util::get_time();
 	m_p.setOrigin(m_p.size().x / 2.f, m_p.size().y / 2.f);
 	m_p.update();
 }
 
 void player_ghost::flush_state(const multiplayer::player_state& s) {
-	m_state		  = s;
-	m_last_update = m_state.updatedAt;
+	// out of order or repeated
+	if (!m_states.empty() && s.updatedAt <= m_states.back().updatedAt) return;
+
+	m_states.push_back(s);
+	while (m_states.size() > MAX_STATES) {
+		m_states.pop_front();
+	}
 }
 
 void player_ghost::flush_data(const multiplayer::player_data& d) {
 	m_data = d;
-	m_nametag.set_name(m_data.name);
 }
 
 void player_ghost::set_particle_manager(particle_manager* pmgr) {
 	m_pmgr = pmgr;
 }
 
-void player_ghost::update() {
+sf::Vector2f player_ghost::latest_position() const {
+	const world::control_vars& v = m_states.empty() ? m_display : m_states.back().controls;
+	return { v.xp, v.yp };
+}
+
+void player_ghost::update(sf::Time latency) {
 	if (m_p.get_fill_color() != m_data.fill) {
 		m_p.set_fill_color(m_data.fill);
 	}
 	if (m_p.get_outline_color() != m_data.outline) {
 		m_p.set_outline_color(m_data.outline);
 	}
-	if (m_p.get_animation() != m_state.anim) {
-		m_p.set_animation(m_state.anim);
-	}
-	m_p.update();
 
 	uint64_t ct	  = util::get_time();
 	sf::Time dt	  = sf::milliseconds(ct - m_last_update);
 	m_last_update = ct;
 
-	debug::get() << "t: " << dt.asSeconds() << "\n";
-
-	// mini physics simulation
-	world::control_vars& v = m_state.controls;
-	world::run_controls(dt, v, m_pmgr);
+	if (!m_states.empty()) {
+		// the point in time we're showing, states are already translated to our clock
+		uint64_t render_time = ct - (latency + RENDER_DELAY).asMilliseconds();
+		m_sample(render_time, dt);
+	}
 
-	v.xp += v.xv * dt.asSeconds();
-	if (v.grounded) {
-		v.yv = 0;
+	if (m_p.get_animation() != m_anim) {
+		m_p.set_animation(m_anim);
 	}
-	v.yp += v.yv * dt.asSeconds();
+	m_p.update();
 
-	m_p.setPosition(v.xp * m_p.size().x, v.yp * m_p.size().y);
-	m_nametag.setPosition(m_p.getPosition().x, m_p.getPosition().y - m_p.size().y);
+	const world::control_vars& v = m_display;
+	sf::Vector2f pos(v.xp + m_error.x, v.yp + m_error.y);
+	m_p.setPosition(pos.x * m_p.size().x, pos.y * m_p.size().y);
 	m_p.setScale(v.sx, v.sy);
 }
 
-void player_ghost::draw(sf::RenderTarget& t, sf::RenderStates s) const {
-	if (m_state.controls.xp == -999) return;
-	s.transform *= getTransform();
+void player_ghost::m_sample(uint64_t render_time, sf::Time dt) {
+	// step past the states we're done with, keeping the one just before the render time to interpolate from
+	while (m_states.size() >= 2 && m_states[1].updatedAt <= render_time) {
+		m_passed(m_states[0], m_states[1]);
+		m_states.pop_front();
+	}
+
+	const multiplayer::player_state& a = m_states.front();
+	world::control_vars next;
+	bool extrapolating = false;
+	if (render_time <= a.updatedAt) {
+		// nothing older to come from yet, hold
+		next   = a.controls;
+		m_anim = a.anim;
+	} else if (m_states.size() >= 2) {
+		const multiplayer::player_state& b = m_states[1];
+		float t								= float(render_time - a.updatedAt) / float(b.updatedAt - a.updatedAt);
+		// discrete state comes from whichever's closer
+		next   = t < 0.5f ? a.controls : b.controls;
+		m_anim = t < 0.5f ? a.anim : b.anim;
+		if (std::hypot(b.controls.xp - a.controls.xp, b.controls.yp - a.controls.yp) < SNAP_DISTANCE) {
+			next.xp = util::lerp(a.controls.xp, b.controls.xp, t);
+			next.yp = util::lerp(a.controls.yp, b.controls.yp, t);
+			next.xv = util::lerp(a.controls.xv, b.controls.xv, t);
+			next.yv = util::lerp(a.controls.yv, b.controls.yv, t);
+		}
+	} else {
+		// ran out of states, keep the newest one going by itself for a little while
+		extrapolating = true;
+		if (m_extrapolated_from != a.updatedAt) {
+			m_extrapolated		= a.controls;
+			m_extrapolated_from = a.updatedAt;
+			m_extrapolated_for	= sf::Time::Zero;
+		}
+		sf::Time target = std::min(sf::milliseconds(render_time - a.updatedAt), MAX_EXTRAPOLATION);
+		sf::Time step	= target - m_extrapolated_for;
+		if (step > sf::Time::Zero) {
+			// mini physics simulation
+			world::control_vars& v = m_extrapolated;
+			world::run_controls(step, v, m_pmgr);
+			v.xp += v.xv * step.asSeconds();
+			if (v.grounded) {
+				v.yv = 0;
+			}
+			v.yp += v.yv * step.asSeconds();
+			m_extrapolated_for = target;
+		}
+		next   = m_extrapolated;
+		m_anim = a.anim;
+	}
+
+	// real states took over from a guess, ease out the difference rather than snapping
+	if (m_extrapolating && !extrapolating && std::hypot(next.xp - m_display.xp, next.yp - m_display.yp) < SNAP_DISTANCE) {
+		m_error += sf::Vector2f(m_display.xp - next.xp, m_display.yp - next.yp);
+	}
+	m_error *= std::exp(-dt.asSeconds() / ERROR_DECAY.asSeconds());
+	m_extrapolating = extrapolating;
+	m_display		= next;
+}
+
+void player_ghost::m_passed(const multiplayer::player_state& from, const multiplayer::player_state& to) {
+	// interpolation never runs the controls, so show wallkicks as they go by
+	if (!m_pmgr) return;
+	if (to.controls.since_wallkick >= from.controls.since_wallkick) return;
+	const world::control_vars& v = to.controls;
+	float xv_sign				 = v.sx < 0 ? 1 : -1;
+	auto& sp					 = m_pmgr->spawn<particles::smoke>();
+	sp.setPosition(v.xp - 0.35f * xv_sign, v.yp);
+	sp.setScale(xv_sign, sp.getScale().y);
+}
+
+void player_ghost::batch(ghost_batch& b) const {
+	if (m_display.xp == -999) return;
+	sf::Transform t = getTransform();
 	// for the extra border tile offset
-	s.transform.translate(1 * m_p.size().x, 0);
-	t.draw(m_p, s);
-	t.draw(m_nametag, s);
+	t.translate(1 * m_p.size().x, 0);
+	b.add_player(t * m_p.getTransform(), m_p.frame(), m_data.fill, m_data.outline);
+	sf::Transform tag = t;
+	tag.translate(m_p.getPosition().x, m_p.getPosition().y - m_p.size().y);
+	b.add_nametag(tag, m_data.name);
 }
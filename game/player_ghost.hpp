@@ -1,28 +1,58 @@
 #pragma once
 
+#include <deque>
+
+#include "ghost_batch.hpp"
 #include "multiplayer.hpp"
-#include "nametag.hpp"
 #include "player.hpp"
 
-class player_ghost : public sf::Drawable, public sf::Transformable {
+class player_ghost : public sf::Transformable {
 public:
 	player_ghost();
 
-	void update();
+	// latency is how long states take to get here from their sender, they're shown that long plus
+	// RENDER_DELAY after they were taken
+	void update(sf::Time latency);
 
 	void flush_state(const multiplayer::player_state& s);
 	void flush_data(const multiplayer::player_data& d);
 
 	void set_particle_manager(particle_manager* pmgr = nullptr);
 
-private:
-	void draw(sf::RenderTarget& t, sf::RenderStates s) const;
+	// where the newest state puts the player, in tiles. kept current even while the ghost isn't being updated
+	sf::Vector2f latest_position() const;
+
+	// add the player & their nametag to a batch of ghosts to draw
+	void batch(ghost_batch& b) const;
 
+private:
+	// ghosts are drawn this far behind when the newest state should have arrived, so there's usually a newer one
+	// to interpolate towards
+	static const sf::Time RENDER_DELAY;
+	// how long a ghost keeps moving on its own once it runs out of states
+	static const sf::Time MAX_EXTRAPOLATION;
+	// how long it takes to smooth out most of the jump when fresh states disagree with the extrapolation
+	static const sf::Time ERROR_DECAY;
+	// states further apart than this (in tiles) are a respawn or teleport, not something to interpolate across
+	static constexpr float SNAP_DISTANCE	 = 3.f;
+	static constexpr std::size_t MAX_STATES = 32;
+
+	std::deque<multiplayer::player_state> m_states;	  // jitter buffer of received states, oldest first, in local time
+
+	world::control_vars m_extrapolated;	  // the newest state, simulated forward
+	uint64_t m_extrapolated_from;		  // updatedAt of the state being extrapolated, 0 if none
+	sf::Time m_extrapolated_for;
+	bool m_extrapolating;
+
+	sf::Vector2f m_error;	// offset still being smoothed out after extrapolation was corrected
 	uint64_t m_last_update;
 	player m_p;
-	nametag m_nametag;
-	multiplayer::player_state m_state;
+	world::control_vars m_display;	 // what's currently drawn
+	std::string m_anim;
 	multiplayer::player_data m_data;
 
 	particle_manager* m_pmgr;
+
+	void m_sample(uint64_t render_time, sf::Time dt);
+	void m_passed(const multiplayer::player_state& from, const multiplayer::player_state& to);
 };
@@ -98,6 +98,10 @@ void replay::set_level_id(int levelid) {
 	m_h.levelId = levelid;
 }
 
+void replay::set_alt(bool alt) {
+	m_h.alt = alt;
+}
+
 const char* replay::get_user() const {
 	return m_h.user;
 }
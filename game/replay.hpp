@@ -32,6 +32,7 @@ public:
 	void set_created(std::time_t created);
 	void set_created_now();
 	void set_level_id(int levelid);
+	void set_alt(bool alt);
 
 	const char* get_user() const;
 	float get_time() const;
@@ -3,8 +3,9 @@
 #include "context.hpp"
 
 resource::resource()
-	: m_window(sf::VideoMode(1600, 928 + 24), "BlockQuest Remake"),
-	  m_playing() {
+	: m_playing() {
+#ifndef HEADLESS
+	m_window.create(sf::VideoMode(1600, 928 + 24), "BlockQuest Remake");
 
 	if (sf::VideoMode::getDesktopMode().width < 1600) {
 		m_window.setSize({ 1366, 768 + 26 });
@@ -23,6 +24,7 @@ resource::resource()
 
 	load_music("menu_bg", "assets/sound/menu_chiptune.wav");
 	load_music("game_bg", "assets/sound/bg1_upbeat.wav");
+#endif
 }
 
 resource& resource::get() {
@@ -31,10 +33,16 @@ resource& resource::get() {
 }
 
 sf::Texture& resource::tex(std::string path) {
+#ifdef HEADLESS
+	// the room server never draws anything, and builds worlds from several threads at once
+	static sf::Texture none;
+	return none;
+#else
 	if (!m_texs.contains(path)) {
 		m_texs[path].loadFromFile(path);
 	}
 	return m_texs[path];
+#endif
 }
 
 ImTextureID resource::imtex(std::string path) {
@@ -43,10 +51,15 @@ ImTextureID resource::imtex(std::string path) {
 }
 
 sf::Font& resource::font(std::string path) {
+#ifdef HEADLESS
+	static sf::Font none;
+	return none;
+#else
 	if (!m_fonts.contains(path)) {
 		m_fonts[path].loadFromFile(path);
 	}
 	return m_fonts[path];
+#endif
 }
 
 void resource::load_music(std::string name, std::string path) {
@@ -95,12 +108,27 @@ void resource::load_sound(std::string name, std::string path) {
 	}
 }
 
+// how many mute_guards are alive on this thread
+static thread_local int mute_depth = 0;
+
+resource::mute_guard::mute_guard(bool mute)
+	: m_mute(mute) {
+	if (m_mute) mute_depth++;
+}
+
+resource::mute_guard::~mute_guard() {
+	if (m_mute) mute_depth--;
+}
+
 void resource::play_sound(std::string name) {
+#ifndef HEADLESS
+	if (mute_depth > 0) return;
 	if (!m_sounds.contains(name)) {
 		throw "a sound of that name was not found!";
 	}
 	m_sounds[name].setVolume(context::get().sfx_volume());
 	m_sounds[name].play();
+#endif
 }
 
 sf::SoundBuffer& resource::sound_buffer(std::string name) {
@@ -38,6 +38,15 @@ public:
 
 	// play the sound with the given name
 	void play_sound(std::string name);
+	// while one of these is alive, play_sound does nothing on the thread that made it (if mute is set)
+	class mute_guard {
+	public:
+		mute_guard(bool mute = true);
+		~mute_guard();
+
+	private:
+		bool m_mute;
+	};
 	// fetch the sound buffer with the given name
 	sf::SoundBuffer& sound_buffer(std::string name);
 
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+/// fixed capacity list that, once full, overwrites the oldest entry on push. index 0 is the oldest.
+/// not thread safe
+template <typename T, std::size_t N>
+class ring_buffer {
+	static_assert(N > 0, "capacity must be positive");
+
+public:
+	void push(T v) {
+		m_slots[(m_start + m_size) % N] = std::move(v);
+		if (m_size < N) {
+			m_size++;
+		} else {
+			m_start = (m_start + 1) % N;
+		}
+	}
+
+	T& operator[](std::size_t i) {
+		return m_slots[(m_start + i) % N];
+	}
+
+	const T& operator[](std::size_t i) const {
+		return m_slots[(m_start + i) % N];
+	}
+
+	std::size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	// entries are left in place, to be overwritten by later pushes
+	void clear() {
+		m_start = 0;
+		m_size	= 0;
+	}
+
+	static constexpr std::size_t capacity() {
+		return N;
+	}
+
+private:
+	std::array<T, N> m_slots;
+	std::size_t m_start = 0;   // slot of the oldest entry
+	std::size_t m_size	= 0;
+};
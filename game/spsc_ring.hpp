@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/// fixed-capacity queue between exactly one producer thread and one consumer thread, neither of which ever locks.
+/// slots are reused in place, so pushing & popping don't allocate beyond what moving a T does
+template <typename T, std::size_t N>
+class spsc_ring {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+	// producer only. false, leaving v alone, if the ring is full
+	bool push(T&& v) {
+		std::size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail_cache == N) {
+			m_tail_cache = m_tail.load(std::memory_order_acquire);
+			if (head - m_tail_cache == N) return false;
+		}
+		m_slots[head & (N - 1)] = std::move(v);
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only. false if the ring is empty
+	bool pop(T& out) {
+		std::size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_head_cache) {
+			m_head_cache = m_head.load(std::memory_order_acquire);
+			if (tail == m_head_cache) return false;
+		}
+		out = std::move(m_slots[tail & (N - 1)]);
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// only a hint from any thread but the consumer, it may be stale by the time it returns
+	bool empty() const {
+		return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+	}
+
+	static constexpr std::size_t capacity() {
+		return N;
+	}
+
+private:
+	// each side's indices on their own cache line, so the threads don't keep stealing it from each other
+	static constexpr std::size_t CACHE_LINE = 64;
+
+	std::array<T, N> m_slots;
+
+	alignas(CACHE_LINE) std::atomic<std::size_t> m_head = 0;   // next slot to write, only the producer moves it
+	std::size_t m_tail_cache							= 0;   // the producer's last look at m_tail
+	alignas(CACHE_LINE) std::atomic<std::size_t> m_tail = 0;   // next slot to read, only the consumer moves it
+	std::size_t m_head_cache							= 0;   // the consumer's last look at m_head
+};
@@ -305,8 +305,7 @@ void edit::update(fsm* sm, sf::Time dt) {
 		} else {
 			// send state updates
 			if (!m_test_playing() || m_test_play_world->lost() || m_test_play_world->won()) {
-				// editing mode, no player on screen
-				// TODO: decrease frequency
+				// editing mode, no player on screen. unchanged states only go out as heartbeats
 				multiplayer::get().emit_state(multiplayer::player_state::empty(auth::get().id()));
 			} else {
 				// gameplay mode
@@ -317,6 +316,21 @@ void edit::update(fsm* sm, sf::Time dt) {
 					.updatedAt = util::get_time() });
 			}
 		}
+		// the part of the level the window shows, which is all of it unless the window's too small.
+		// ghosts are drawn a tile to the right, for the border
+		float ts = m_level().map().tile_size();
+		sf::FloatRect view(-1, 0, 0, 0);
+		sf::FloatRect window(sf::Vector2f(0, 0), sf::Vector2f(resource::get().window().getSize()));
+		sf::FloatRect on_screen;
+		if (m_map.getGlobalBounds().intersects(window, on_screen)) {
+			sf::FloatRect shown = m_map.getInverseTransform().transformRect(on_screen);
+			view				= sf::FloatRect(shown.left / ts - 1, shown.top / ts, shown.width / ts, shown.height / ts);
+		}
+		if (m_test_playing() && !m_test_play_world->lost() && !m_test_play_world->won()) {
+			multiplayer::get().set_view(view, m_test_play_world->get_player_pos());
+		} else {
+			multiplayer::get().set_view(view);
+		}
 	}
 
 	// DRAW
@@ -19,6 +19,9 @@ search::search()
 	  m_order_opts{ "asc", "desc" },
 	  m_temp_rows(query().rows),
 	  m_temp_cols(query().cols),
+	  m_page_cache(PAGE_CACHE_SIZE),
+	  m_page(std::make_shared<result_page>()),
+	  m_prefetched(false),
 	  m_loading_gif(resource::get().tex("assets/gifs/loading-gif.png"), 29, { 200, 200 }, 40) {
 	auto sort_it		= std::find_if(std::begin(m_sort_opts), std::end(m_sort_opts),
 									   [this](const char* str) { return std::string(str) == query().sortBy; });
@@ -45,12 +48,18 @@ search::~search() {
 void search::update(fsm* sm, sf::Time dt) {
 	m_loading_gif.update();
 	// check if a pending query is ready, and update status accordingly
-	m_query_handle.poll();
+	m_poll_page(*m_page);
+	for (auto& page : m_prefetch) {
+		m_poll_page(*page);
+	}
+	if (!m_prefetched && m_page->handle.ready() && m_page->handle.get().success) {
+		m_prefetch_adjacent();
+	}
 	bool authed = auth::get().authed();
 	if (!m_authed_last_frame && authed) {
-		m_update_query();
+		m_refresh();
 	} else if (m_authed_last_frame && !authed) {
-		m_update_query();
+		m_refresh();
 	}
 	m_authed_last_frame = authed;
 }
@@ -151,13 +160,13 @@ void search::imdraw(fsm* sm) {
 	ImGui::SliderInt("Rows", &m_temp_rows, 1, 4);
 	ImGui::SliderInt("Cols", &m_temp_cols, 1, 5);
 
-	if (m_query_handle.ready() && !m_query_handle.get().success) {
+	if (m_page->handle.ready() && !m_page->handle.get().success) {
 		ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(sf::Color::Red));
-		ImGui::TextWrapped("%s", m_query_handle.get().error->c_str());
+		ImGui::TextWrapped("%s", m_page->handle.get().error->c_str());
 		ImGui::PopStyleColor();
 	}
 	if (ImGui::ImageButtonWithText(resource::get().imtex("assets/gui/search.png"), "Refresh")) {
-		m_update_query();
+		m_refresh();
 	}
 
 	ImGui::End();
@@ -167,7 +176,7 @@ void search::imdraw(fsm* sm) {
 	ImGui::SetNextWindowPos(ImVec2(0, 26), ImGuiCond_Always);
 	ImGui::SetNextWindowSize(results_sz, ImGuiCond_Always);
 	ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0);
-	if (m_query_handle.ready() && m_query_handle.get().success) {
+	if (m_page->handle.ready() && m_page->handle.get().success) {
 		int page			 = m_cpage();
 		std::string page_str = "Results (Page " + std::to_string(page) + ")###Search";
 		ImGui::Begin(page_str.c_str(), nullptr, flat);
@@ -180,24 +189,24 @@ void search::imdraw(fsm* sm) {
 		sf::Vector2i sz(100, 100);
 		ImGui::SetCursorPos(ImVec2((results_sz.x - sz.x) / 2.f, (results_sz.y - sz.y) / 2.f));
 		m_loading_gif.draw(sz);
-	} else if (m_query_handle.ready() && m_query_handle.get().success && m_query_handle.get().levels.size() >= 1) {
+	} else if (m_page->handle.ready() && m_page->handle.get().success && m_page->handle.get().levels.size() >= 1) {
 		// pagination buttons
 		int page = m_cpage();
 		ImGui::BeginDisabled(page == 0);
 		if (ImGui::ImageButtonWithText(resource::get().imtex("assets/gui/back.png"), "Back")) {
-			if (m_query_handle.ready()) m_prev_page();
+			if (m_page->handle.ready()) m_prev_page();
 		}
 		ImGui::EndDisabled();
 		ImGui::SameLine();
 		ImGui::BeginDisabled(m_last_page());
 		if (ImGui::ImageButtonWithText(resource::get().imtex("assets/gui/forward.png"), "Next")) {
-			if (m_query_handle.ready()) m_next_page();
+			if (m_page->handle.ready()) m_next_page();
 		}
 		ImGui::EndDisabled();
 
 		// this can be unset if next/prev page is called
 		ImGuiTableFlags flags = ImGuiTableFlags_BordersInnerH;
-		if (m_query_handle.ready() && ImGui::BeginTable("###LevelDisplay", query().cols, flags)) {
+		if (m_page->handle.ready() && ImGui::BeginTable("###LevelDisplay", query().cols, flags)) {
 			// level table
 			bool no_more_levels = false;
 			for (int row = 0; row < query().rows && !no_more_levels; ++row) {
@@ -207,11 +216,11 @@ void search::imdraw(fsm* sm) {
 					ImGui::TableNextColumn();
 					int idx = row * query().cols + col;
 
-					api::level& l	 = m_query_handle.get().levels[idx];
+					api::level& l	 = m_page->handle.get().levels[idx];
 					level_card& tile = m_gui_level_tile(l);
 					tile.imdraw(sm);
 					ImGui::PopID();
-					if (idx >= m_query_handle.get().levels.size() - 1) {
+					if (idx >= m_page->handle.get().levels.size() - 1) {
 						no_more_levels = true;
 						break;
 					}
@@ -230,15 +239,59 @@ api::level_search_query& search::query() {
 }
 
 level_card& search::m_gui_level_tile(api::level& lvl) {
-	if (!m_api_level_tile.contains(lvl.id)) {
-		m_api_level_tile[lvl.id] = std::make_shared<level_card>(lvl);
+	if (!m_page->cards.contains(lvl.id)) {
+		m_page->cards[lvl.id] = std::make_shared<level_card>(lvl);
+	}
+	return *m_page->cards[lvl.id].get();
+}
+
+std::shared_ptr<search::result_page> search::m_fetch_page(const api::level_search_query& q, io_pool::priority p) {
+	std::string key = nlohmann::json(q).dump();
+	if (auto page = m_page_cache.get(key)) {
+		return *page;
+	}
+	auto page = std::make_shared<result_page>();
+	page->key = key;
+	page->handle.reset(api::get().search_levels(q, p));
+	m_page_cache.put(key, page);
+	return page;
+}
+
+void search::m_poll_page(result_page& page) {
+	if (page.handle.ready()) return;
+	page.handle.poll();
+	if (!page.handle.ready()) return;
+	if (!page.handle.get().success) {
+		// don't hold on to failures, so that revisiting the page retries it
+		m_page_cache.erase(page.key);
+		return;
+	}
+	// start preparing the previews right away, even if the page isn't displayed yet
+	for (auto& lvl : page.handle.get().levels) {
+		if (!page.cards.contains(lvl.id)) {
+			page.cards[lvl.id] = std::make_shared<level_card>(lvl);
+		}
+	}
+}
+
+void search::m_prefetch_adjacent() {
+	m_prefetched = true;
+	m_prefetch.clear();
+	if (!m_last_page()) {
+		api::level_search_query next = query();
+		next.cursor					 = m_page->handle.get().cursor;
+		m_prefetch.push_back(m_fetch_page(next, io_pool::PREFETCH));
+	}
+	if (m_cpage() != 0) {
+		api::level_search_query prev = query();
+		prev.cursor					 = m_cursor_log.top();
+		m_prefetch.push_back(m_fetch_page(prev, io_pool::PREFETCH));
 	}
-	return *m_api_level_tile[lvl.id].get();
 }
 
 void search::m_next_page() {
 	m_cursor_log.push(query().cursor);
-	query().cursor = m_query_handle.get().cursor;
+	query().cursor = m_page->handle.get().cursor;
 	m_update_query();
 }
 
@@ -251,7 +304,7 @@ void search::m_prev_page() {
 }
 
 bool search::m_last_page() const {
-	return m_query_handle.ready() && m_query_handle.get().success && m_query_handle.get().cursor == -1;
+	return m_page->handle.ready() && m_page->handle.get().success && m_page->handle.get().cursor == -1;
 }
 
 int search::m_cpage() const {
@@ -264,21 +317,30 @@ void search::m_update_query() {
 	query().rows   = m_temp_rows;
 	query().cols   = m_temp_cols;
 
-	// wait for the current request to process
-	if (m_query_handle.fetching()) return;
+	// drop the superseded request, rather than waiting on it
+	if (m_page->handle.fetching()) {
+		m_page_cache.erase(m_page->key);
+		m_page->handle.reset();
+	}
 	debug::log() << "Search query updated\n";
-	m_api_level_tile.clear();
 
 	if (query() != m_last_query) {
 		m_cursor_log   = {};
 		query().cursor = -1;
 	}
 
-	m_query_handle.reset(api::get().search_levels(query()));
+	m_page		 = m_fetch_page(query());
+	m_prefetched = false;
 	m_last_query = query();
 }
 
+void search::m_refresh() {
+	m_page_cache.clear();
+	m_prefetch.clear();
+	m_update_query();
+}
+
 bool search::m_searching() const {
-	return m_query_handle.fetching();
+	return m_page->handle.fetching();
 }
 }
@@ -4,6 +4,7 @@
 #include <stack>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "../fsm.hpp"
 
@@ -12,6 +13,7 @@
 #include "gui/menu_bar.hpp"
 
 #include "api.hpp"
+#include "lru_cache.hpp"
 
 namespace states {
 
@@ -50,14 +52,30 @@ private:
 
 	bool m_authed_last_frame;	// tracks the auth status so we can trigger an event when authed
 
-	api_handle<api::level_search_response> m_query_handle;	 // holds the active query future
 	api_handle<api::level_response> m_quickplay_handle;
 
-	// handles automatic loading & caching to prevent unnecessary draws
-	std::unordered_map<int, std::shared_ptr<level_card>> m_api_level_tile;
+	// a page of search results, along with the level cards made for it
+	struct result_page {
+		std::string key;   // the query & cursor the page was fetched with
+		api_handle<api::level_search_response> handle;
+		std::unordered_map<int, std::shared_ptr<level_card>> cards;
+	};
+	static constexpr int PAGE_CACHE_SIZE = 6;
+	lru_cache<std::string, std::shared_ptr<result_page>> m_page_cache;	 // recently visited & prefetched pages
+	std::shared_ptr<result_page> m_page;								 // the page currently displayed
+	std::vector<std::shared_ptr<result_page>> m_prefetch;				 // pages adjacent to the current one
+	bool m_prefetched;													 // have we prefetched around the current page
+
+	// fetches the page for the given query & cursor, from the cache if present
+	std::shared_ptr<result_page> m_fetch_page(const api::level_search_query& q, io_pool::priority p = io_pool::USER);
+	// polls the page's query, creating its level cards once the results arrive
+	void m_poll_page(result_page& page);
+	// speculatively fetches the pages before & after the current one
+	void m_prefetch_adjacent();
 	level_card& m_gui_level_tile(api::level& lvl);
 
 	void m_update_query();	 // sends the query to the api
+	void m_refresh();		 // drops all cached pages & re-sends the query
 	void m_next_page();
 	void m_prev_page();
 
@@ -4,37 +4,81 @@
 #include "debug.hpp"
 #include "util.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
-#include <unordered_set>
 
 tilemap::tilemap(sf::Texture& tex, int xs, int ys, int ts, int tex_ts)
 	: m_tex(tex), m_xs(xs), m_ys(ys), m_ts(ts), m_tex_ts(tex_ts), m_editor(false) {
-	m_va.setPrimitiveType(sf::Quads);
-	m_va_editor.setPrimitiveType(sf::Quads);
-	m_va_arrows.setPrimitiveType(sf::Quads);
-	m_tiles.resize(xs * ys, tile::empty);
+	m_reset();
+	m_recount();
 	m_flush_va();
 }
 
+tilemap::storage& tilemap::m_mut() {
+	if (m_data.use_count() > 1) {
+		m_data = std::make_shared<storage>(*m_data);
+	}
+	return *m_data;
+}
+
+void tilemap::m_reset() {
+	m_data = std::make_shared<storage>();
+	m_data->va.setPrimitiveType(sf::Quads);
+	m_data->va_editor.setPrimitiveType(sf::Quads);
+	m_data->va_arrows.setPrimitiveType(sf::Quads);
+	m_data->tiles.resize(m_xs * m_ys, tile::empty);
+	m_found_first.fill(FIRST_DIRTY);
+}
+
+std::shared_ptr<const tilemap::storage> tilemap::snapshot() const {
+	return m_data;
+}
+
+void tilemap::restore(std::shared_ptr<const tilemap::storage> data) {
+	if (data->tiles.size() != m_xs * m_ys) {
+		throw std::runtime_error("Cannot restore a tilemap snapshot of a different size.");
+	}
+	// the snapshot is never written to through this map, m_mut() copies it first
+	m_data = std::const_pointer_cast<storage>(data);
+	m_found_first.fill(FIRST_DIRTY);
+}
+
+uint64_t tilemap::hash() const {
+	return m_data->hash;
+}
+
+uint64_t tilemap::m_tile_hash(int i, const tile& t) {
+	if (t == tile::empty) return 0;
+	// xxh64 primes & avalanche
+	uint64_t h = (uint64_t(i) << 16 | uint64_t(uint8_t(t.type)) << 8 | uint64_t(uint8_t(t.props.moving))) * 0x9E3779B185EBCA87ull;
+	h ^= h >> 33;
+	h *= 0xC2B2AE3D27D4EB4Full;
+	h ^= h >> 29;
+	h *= 0x165667B19E3779F9ull;
+	h ^= h >> 32;
+	return h;
+}
+
 void tilemap::draw(sf::RenderTarget& t, sf::RenderStates s) const {
 	s.transform *= getTransform();
 	s.texture = &m_tex;
-	t.draw(m_va, s);
+	t.draw(m_data->va, s);
 	if (m_editor) {
-		t.draw(m_va_editor, s);
-		t.draw(m_va_arrows, s);
+		t.draw(m_data->va_editor, s);
+		t.draw(m_data->va_arrows, s);
 	}
 }
 
 void tilemap::m_flush_va() {
-	m_va.clear();
-	m_va.resize(m_xs * m_ys * 4);
-	m_va_editor.clear();
-	m_va_editor.resize(m_xs * m_ys * 4);
-	m_va_arrows.clear();
-	m_va_arrows.resize(m_xs * m_ys * 4);
-	for (int i = 0; i < m_tiles.size(); ++i) {
+	storage& d = m_mut();
+	d.va.clear();
+	d.va.resize(m_xs * m_ys * 4);
+	d.va_editor.clear();
+	d.va_editor.resize(m_xs * m_ys * 4);
+	d.va_arrows.clear();
+	d.va_arrows.resize(m_xs * m_ys * 4);
+	for (int i = 0; i < d.tiles.size(); ++i) {
 		m_update_quad(i);
 	}
 }
@@ -44,40 +88,45 @@ void tilemap::m_set_quad(int i, tile t) {
 	int x = i % m_xs;
 	int y = i / m_xs;
 
+	storage& d				   = m_mut();
+	sf::VertexArray& va		   = d.va;
+	sf::VertexArray& va_editor = d.va_editor;
+	sf::VertexArray& va_arrows = d.va_arrows;
+
 	sf::Vertex air;
 
 	if (t == tile::empty) {
-		m_va[i * 4]			   = air;
-		m_va[i * 4 + 1]		   = air;
-		m_va[i * 4 + 2]		   = air;
-		m_va[i * 4 + 3]		   = air;
-		m_va_editor[i * 4]	   = air;
-		m_va_editor[i * 4 + 1] = air;
-		m_va_editor[i * 4 + 2] = air;
-		m_va_editor[i * 4 + 3] = air;
-		m_va_arrows[i * 4]	   = air;
-		m_va_arrows[i * 4 + 1] = air;
-		m_va_arrows[i * 4 + 2] = air;
-		m_va_arrows[i * 4 + 3] = air;
+		va[i * 4]			 = air;
+		va[i * 4 + 1]		 = air;
+		va[i * 4 + 2]		 = air;
+		va[i * 4 + 3]		 = air;
+		va_editor[i * 4]	 = air;
+		va_editor[i * 4 + 1] = air;
+		va_editor[i * 4 + 2] = air;
+		va_editor[i * 4 + 3] = air;
+		va_arrows[i * 4]	 = air;
+		va_arrows[i * 4 + 1] = air;
+		va_arrows[i * 4 + 2] = air;
+		va_arrows[i * 4 + 3] = air;
 		return;
 	}
 
-	int tx = int(t) % (m_tex.getSize().x / m_tex_ts);
-	int ty = int(t) / (m_tex.getSize().x / m_tex_ts);
+	int tx = int(t) % m_tex_cols();
+	int ty = int(t) / m_tex_cols();
 
 	// tiles only visible in editor mode
-	sf::VertexArray& va_to_modify = t.editor_only() ? m_va_editor : m_va;
+	sf::VertexArray& va_to_modify = t.editor_only() ? va_editor : va;
 	// remove editor tiles on this spot if placing a non-editor tile on it
 	if (!t.editor_only()) {
-		m_va_editor[i * 4]	   = air;
-		m_va_editor[i * 4 + 1] = air;
-		m_va_editor[i * 4 + 2] = air;
-		m_va_editor[i * 4 + 3] = air;
+		va_editor[i * 4]	 = air;
+		va_editor[i * 4 + 1] = air;
+		va_editor[i * 4 + 2] = air;
+		va_editor[i * 4 + 3] = air;
 	} else {
-		m_va[i * 4]		= air;
-		m_va[i * 4 + 1] = air;
-		m_va[i * 4 + 2] = air;
-		m_va[i * 4 + 3] = air;
+		va[i * 4]	  = air;
+		va[i * 4 + 1] = air;
+		va[i * 4 + 2] = air;
+		va[i * 4 + 3] = air;
 	}
 
 	// fill in the quad
@@ -104,31 +153,31 @@ void tilemap::m_set_quad(int i, tile t) {
 	// render movement arrows in editor mode
 	if (t.props.moving != 0) {
 		tile nt = tile::tile_type(tile::move_up_bit + t.props.moving - 1);
-		int ntx = int(nt) % (m_tex.getSize().x / m_tex_ts);
-		int nty = int(nt) / (m_tex.getSize().x / m_tex_ts);
-
-		m_va_arrows[i * 4].position.x  = x * m_ts;
-		m_va_arrows[i * 4].position.y  = y * m_ts;
-		m_va_arrows[i * 4].texCoords.x = ntx * m_tex_ts;
-		m_va_arrows[i * 4].texCoords.y = nty * m_tex_ts;
-
-		m_va_arrows[i * 4 + 1].position.x  = (x + 1) * m_ts;
-		m_va_arrows[i * 4 + 1].position.y  = y * m_ts;
-		m_va_arrows[i * 4 + 1].texCoords.x = (ntx + 1) * m_tex_ts;
-		m_va_arrows[i * 4 + 1].texCoords.y = nty * m_tex_ts;
-
-		m_va_arrows[i * 4 + 2].position.x  = (x + 1) * m_ts;
-		m_va_arrows[i * 4 + 2].position.y  = (y + 1) * m_ts;
-		m_va_arrows[i * 4 + 2].texCoords.x = (ntx + 1) * m_tex_ts;
-		m_va_arrows[i * 4 + 2].texCoords.y = (nty + 1) * m_tex_ts;
-
-		m_va_arrows[i * 4 + 3].position.x  = x * m_ts;
-		m_va_arrows[i * 4 + 3].position.y  = (y + 1) * m_ts;
-		m_va_arrows[i * 4 + 3].texCoords.x = ntx * m_tex_ts;
-		m_va_arrows[i * 4 + 3].texCoords.y = (nty + 1) * m_tex_ts;
+		int ntx = int(nt) % m_tex_cols();
+		int nty = int(nt) / m_tex_cols();
+
+		va_arrows[i * 4].position.x	 = x * m_ts;
+		va_arrows[i * 4].position.y	 = y * m_ts;
+		va_arrows[i * 4].texCoords.x = ntx * m_tex_ts;
+		va_arrows[i * 4].texCoords.y = nty * m_tex_ts;
+
+		va_arrows[i * 4 + 1].position.x	 = (x + 1) * m_ts;
+		va_arrows[i * 4 + 1].position.y	 = y * m_ts;
+		va_arrows[i * 4 + 1].texCoords.x = (ntx + 1) * m_tex_ts;
+		va_arrows[i * 4 + 1].texCoords.y = nty * m_tex_ts;
+
+		va_arrows[i * 4 + 2].position.x	 = (x + 1) * m_ts;
+		va_arrows[i * 4 + 2].position.y	 = (y + 1) * m_ts;
+		va_arrows[i * 4 + 2].texCoords.x = (ntx + 1) * m_tex_ts;
+		va_arrows[i * 4 + 2].texCoords.y = (nty + 1) * m_tex_ts;
+
+		va_arrows[i * 4 + 3].position.x	 = x * m_ts;
+		va_arrows[i * 4 + 3].position.y	 = (y + 1) * m_ts;
+		va_arrows[i * 4 + 3].texCoords.x = ntx * m_tex_ts;
+		va_arrows[i * 4 + 3].texCoords.y = (nty + 1) * m_tex_ts;
 	} else {
 		for (int k = 0; k < 4; ++k) {
-			m_va_arrows[i * 4 + k] = sf::Vertex();
+			va_arrows[i * 4 + k] = sf::Vertex();
 		}
 	}
 }
@@ -163,12 +212,13 @@ std::optional<tilemap::diff> tilemap::set(int x, int y, tile t) {
 	tilemap::diff d;
 	d.x		 = x;
 	d.y		 = y;
-	d.before = m_tiles[x + y * m_xs];
+	d.before = m_data->tiles[x + y * m_xs];
 	d.after	 = t;
 
-	t.m_x				  = x;
-	t.m_y				  = y;
-	m_tiles[x + y * m_xs] = t;
+	t.m_x = x;
+	t.m_y = y;
+	m_track(x + y * m_xs, d.before, t);
+	m_mut().tiles[x + y * m_xs] = t;
 	m_update_quad(x + y * m_xs);
 	return d;
 }
@@ -197,35 +247,46 @@ std::vector<tilemap::diff> tilemap::set_rect(sf::Vector2i min, sf::Vector2i max,
 std::vector<tilemap::diff> tilemap::set_line(sf::Vector2i min, sf::Vector2i max, tile tl) {
 	std::vector<tilemap::diff> ret;
 
-	const sf::Vector2i dist = max - min;
-	std::unordered_set<sf::Vector2i, util::vector_hash<int>> already_passed;
-	// will do 45 iterations (max necessary for diagonal across map)
-	for (float t = 0; t <= 1; t += 0.022f) {
-		sf::Vector2i lerped(
-			std::round(util::lerp(min.x, max.x, t)),
-			std::round(util::lerp(min.y, max.y, t)));
-		if (already_passed.contains(lerped)) continue;
-		already_passed.insert(lerped);
-		auto diff = set(lerped.x, lerped.y, tl);
+	// integer bresenham, visits every tile on the line exactly once
+	const int dx = std::abs(max.x - min.x);
+	const int dy = -std::abs(max.y - min.y);
+	const int sx = min.x < max.x ? 1 : -1;
+	const int sy = min.y < max.y ? 1 : -1;
+	ret.reserve(std::max(dx, -dy) + 1);
+
+	int err = dx + dy;
+	sf::Vector2i pos = min;
+	while (true) {
+		auto diff = set(pos.x, pos.y, tl);
 		if (diff) {
 			ret.push_back(*diff);
 		}
+		if (pos == max) break;
+		const int e2 = 2 * err;
+		if (e2 >= dy) {
+			err += dy;
+			pos.x += sx;
+		}
+		if (e2 <= dx) {
+			err += dx;
+			pos.y += sy;
+		}
 	}
 	return ret;
 }
 
 tile tilemap::get(int x, int y) const {
 	if (m_oob(x, y)) return m_oob_tile(x, y);
-	return m_tiles[x + y * m_xs];
+	return m_data->tiles[x + y * m_xs];
 }
 
 tile tilemap::get(int i) const {
 	if (m_oob(i)) return m_oob_tile(i / m_xs, i % m_ys);
-	return m_tiles[i];
+	return m_data->tiles[i];
 }
 
 const std::vector<tile>& tilemap::get() const {
-	return m_tiles;
+	return m_data->tiles;
 }
 
 std::optional<tilemap::diff> tilemap::clear(int x, int y) {
@@ -239,13 +300,13 @@ std::vector<tilemap::diff> tilemap::clear() {
 			ret.push_back({
 				.x		= x,
 				.y		= y,
-				.before = m_tiles[x + y * m_xs].type,
+				.before = m_data->tiles[x + y * m_xs].type,
 				.after	= tile::empty,
 			});
 		}
 	}
-	m_tiles.clear();
-	m_tiles.resize(m_xs * m_ys, tile::empty);
+	m_reset();
+	m_recount();
 	m_flush_va();
 	return ret;
 }
@@ -338,20 +399,74 @@ int tilemap::count() const {
 }
 
 int tilemap::tile_count(tile::tile_type type) const {
-	return std::count_if(m_tiles.cbegin(), m_tiles.cend(), [type](const tile& t) {
-		return t.type == type;
-	});
+	int slot = m_type_slot(type);
+	if (slot < 0) return 0;
+	return m_data->type_count[slot];
 }
 
 sf::Vector2i tilemap::find_first_of(tile::tile_type type) const {
-	for (int x = 0; x < m_xs; ++x) {
-		for (int y = 0; y < m_ys; ++y) {
-			if (get(x, y) == type) {
-				return { x, y };
-			}
+	int slot = m_type_slot(type);
+	if (slot < 0 || m_data->type_count[slot] == 0) return { -1, -1 };
+	int i = m_data->type_first[slot];
+	if (i == FIRST_DIRTY) {
+		// O(n) once per write that removed the first of this type, O(1) after that
+		int& found = m_found_first[slot];
+		if (found == FIRST_DIRTY) {
+			const std::vector<tile>& tiles = m_data->tiles;
+			auto it = std::find_if(tiles.cbegin(), tiles.cend(), [type](const tile& t) {
+				return t.type == type;
+			});
+			found = std::distance(tiles.cbegin(), it);
+		}
+		i = found;
+	}
+	return { i % m_xs, i / m_xs };
+}
+
+int tilemap::m_type_slot(tile::tile_type type) {
+	int slot = int(type) + 1;
+	return slot >= 0 && slot < TYPE_SLOTS ? slot : -1;
+}
+
+void tilemap::m_track(int i, const tile& before, const tile& after) {
+	if (before.eq(after)) return;
+	storage& d = m_mut();
+	// the map hash is a sum of per-tile hashes, so a single tile can be swapped out of it
+	d.hash += m_tile_hash(i, after) - m_tile_hash(i, before);
+	if (before.type == after.type) return;
+	if (int slot = m_type_slot(before.type); slot >= 0) {
+		m_found_first[slot] = FIRST_DIRTY;
+		if (--d.type_count[slot] == 0) {
+			d.type_first[slot] = FIRST_NONE;
+		} else if (d.type_first[slot] == i) {
+			d.type_first[slot] = FIRST_DIRTY;
+		}
+	}
+	if (int slot = m_type_slot(after.type); slot >= 0) {
+		m_found_first[slot] = FIRST_DIRTY;
+		++d.type_count[slot];
+		int& first = d.type_first[slot];
+		if (first == FIRST_NONE || (first != FIRST_DIRTY && i < first)) {
+			first = i;
+		}
+	}
+}
+
+void tilemap::m_recount() {
+	storage& d = m_mut();
+	d.type_count.fill(0);
+	d.type_first.fill(FIRST_NONE);
+	m_found_first.fill(FIRST_DIRTY);
+	// seeded with the map dimensions, using tiles that never appear in a map
+	d.hash = m_tile_hash(m_xs * m_ys, tile::border) + m_tile_hash(m_xs, tile::cursor);
+	for (int i = 0; i < d.tiles.size(); ++i) {
+		d.hash += m_tile_hash(i, d.tiles[i]);
+		int slot = m_type_slot(d.tiles[i].type);
+		if (slot < 0) continue;
+		if (d.type_count[slot]++ == 0) {
+			d.type_first[slot] = i;
 		}
 	}
-	return { -1, -1 };
 }
 
 void tilemap::set_editor_view(bool state) {
@@ -359,7 +474,7 @@ void tilemap::set_editor_view(bool state) {
 }
 
 void tilemap::m_update_quad(int i) {
-	m_set_quad(i, m_tiles[i]);
+	m_set_quad(i, m_data->tiles[i]);
 }
 
 bool tilemap::m_oob(int x, int y) const {
@@ -367,13 +482,17 @@ bool tilemap::m_oob(int x, int y) const {
 }
 
 bool tilemap::m_oob(int i) const {
-	return i > m_tiles.size();
+	return i > m_data->tiles.size();
+}
+
+int tilemap::m_tex_cols() const {
+	return std::max(1, int(m_tex.getSize().x) / m_tex_ts);
 }
 
 sf::IntRect tilemap::calculate_texture_rect(tile t) const {
 	sf::IntRect res;
-	res.left = int(t) % (m_tex.getSize().x / m_tex_ts);
-	res.top	 = int(t) / (m_tex.getSize().x / m_tex_ts);
+	res.left = int(t) % m_tex_cols();
+	res.top	 = int(t) / m_tex_cols();
 	res.left *= m_tex_ts;
 	res.top *= m_tex_ts;
 	res.width  = m_tex_ts;
@@ -384,7 +503,7 @@ sf::IntRect tilemap::calculate_texture_rect(tile t) const {
 std::string tilemap::save() const {
 	std::ostringstream ss;
 	ss << std::setfill('0');
-	for (auto& tile : m_tiles) {
+	for (auto& tile : m_data->tiles) {
 		if (tile == tile::empty) {
 			ss << std::setw(1) << "/";
 			continue;
@@ -398,14 +517,14 @@ std::string tilemap::save() const {
 }
 
 void tilemap::load(std::string str) {
-	m_tiles.clear();
-	m_tiles.resize(m_xs * m_ys, tile::empty);
+	m_reset();
+	std::vector<tile>& tiles = m_data->tiles;
 	std::istringstream ss(str);
 	for (int i = 0; i < m_xs * m_ys; ++i) {
-		m_tiles[i].m_x = int(i % m_xs);
-		m_tiles[i].m_y = int(i / m_xs);
+		tiles[i].m_x = int(i % m_xs);
+		tiles[i].m_y = int(i / m_xs);
 		if (ss.peek() == '/') {
-			m_tiles[i].type = tile::empty;
+			tiles[i].type = tile::empty;
 			char ch;
 			ss >> ch;
 			continue;
@@ -413,13 +532,14 @@ void tilemap::load(std::string str) {
 		try {
 			char buf[3];
 			ss.get(buf, 3);
-			m_tiles[i].type = static_cast<tile::tile_type>(std::stoi(buf));
+			tiles[i].type = static_cast<tile::tile_type>(std::stoi(buf));
 			ss.get(buf, 2);
-			m_tiles[i].props.moving = std::stoi(buf);
+			tiles[i].props.moving = std::stoi(buf);
 		} catch (std::invalid_argument const& e) {
-			m_tiles[i] = tile::empty;
+			tiles[i] = tile::empty;
 		}
 	}
+	m_recount();
 	m_flush_va();
 }
 
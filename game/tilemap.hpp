@@ -1,7 +1,10 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <array>
+#include <cstdint>
 #include <cstring>
+#include <memory>
 #include <optional>
 #include <ranges>
 #include <unordered_map>
@@ -126,7 +129,7 @@ public:
 	int count() const;				   // total tile count
 
 	int tile_count(tile::tile_type type) const;				  // how many tiles of a given type are there
-	sf::Vector2i find_first_of(tile::tile_type type) const;	  // find the first of a type of tile
+	sf::Vector2i find_first_of(tile::tile_type type) const;	  // find the first (row-major) of a type of tile, or -1, -1
 
 	void set_editor_view(bool state);	// toggle editor view
 
@@ -137,25 +140,60 @@ public:
 
 	static bool diffs_equal(std::vector<diff> a, std::vector<diff> b);	 // are the two diff sets equal?
 
+	// per-type tile histograms, kept in sync on every write. indexed by type + 1 so tile::empty fits
+	static constexpr int TYPE_SLOTS	 = tile::border + 2;
+	static constexpr int FIRST_NONE	 = -1;	 // no tile of this type exists
+	static constexpr int FIRST_DIRTY = -2;	 // the first tile was removed, rescan on next lookup
+
+	// the contents of a map. copies of a tilemap share one storage until either of them is written to, and
+	// it's only ever changed through m_mut(), so reads of a shared storage are safe from any thread
+	struct storage {
+		std::vector<tile> tiles;	 // all tiles
+		sf::VertexArray va;			 // the tilemap vertex cache itself
+		sf::VertexArray va_editor;	 // additional rendering on top of the tilemap only displayed in editor mode.
+		sf::VertexArray va_arrows;	 // just for displaying moving arrows
+
+		std::array<int, TYPE_SLOTS> type_count;	  // how many tiles of each type there are
+		std::array<int, TYPE_SLOTS> type_first;	  // index of the first tile of each type
+
+		uint64_t hash;	 // content hash, updated on every write
+	};
+
+	std::shared_ptr<const storage> snapshot() const;	 // an immutable handle to the current contents of the map
+	void restore(std::shared_ptr<const storage> data);	 // share the contents of a snapshot taken from a map of the same size
+
+	uint64_t hash() const;	 // 64-bit hash of all tiles in the map, equal for maps with the same contents. O(1)
+
 private:
 	// render the map! :3
 	void draw(sf::RenderTarget&, sf::RenderStates) const;
 
 	sf::Texture& m_tex;	  // texture to use
 
-	sf::VertexArray m_va;			  // the tilemap vertex cache itself
-	sf::VertexArray m_va_editor;	  // additional rendering on top of the tilemap only displayed in editor mode.
-	sf::VertexArray m_va_arrows;	  // just for displaying moving arrows
-	void m_flush_va();				  // fully resets m_va with the cached tile data
-	void m_update_quad(int i);		  // sets the quad at the index to the tile value in m_tiles
+	std::shared_ptr<storage> m_data;   // copy-on-write map contents
+	storage& m_mut();				   // the map contents, made unique to this map first so they can be written to
+	void m_reset();	  // replace the map contents with fresh, empty storage
+
+	// where the rescans of FIRST_DIRTY types found their first tile, or FIRST_DIRTY if not looked up yet. kept per
+	// map rather than in the storage, so lookups never write to contents other maps (& threads) may share
+	mutable std::array<int, TYPE_SLOTS> m_found_first;
+
+	void m_flush_va();				  // fully resets the vertex cache with the cached tile data
+	void m_update_quad(int i);		  // sets the quad at the index to the stored tile value
 	void m_set_quad(int i, tile t);	  // sets the quad at the index to the given tile
+	int m_tex_cols() const;			  // how many tiles wide the texture is, at least 1 so an unloaded texture doesn't divide by zero
 
 	bool m_oob(int x, int y) const;	  // check if the given tile x / y is out of bounds
 	bool m_oob(int i) const;		  // check if the given tile index is out of bounds
 
 	tile m_oob_tile(int x, int y) const;   // return the tile at the given oob position
 
-	std::vector<tile> m_tiles;	 // all tiles
+	static int m_type_slot(tile::tile_type type);	// histogram slot of a type, or -1 if it's not a valid type
+
+	static uint64_t m_tile_hash(int i, const tile& t);	 // xxhash-style avalanche of a single tile at an index, 0 if empty
+
+	void m_track(int i, const tile& before, const tile& after);	  // update the histograms & hash for a single tile write
+	void m_recount();											  // rebuild the histograms & hash from scratch
 
 	int m_xs, m_ys;	  // dimension of the tilemap in tiles
 	int m_ts;		  // dimension of one tile as rendered
@@ -1,5 +1,8 @@
 #include "world.hpp"
 
+#include <cmath>
+#include <limits>
+
 #include "context.hpp"
 #include "debug.hpp"
 #include "imgui_internal.h"
@@ -42,69 +45,87 @@ const world::control_vars world::control_vars::empty = {
 	.tile_above			  = false
 };
 
-sio::message::ptr world::control_vars::to_message() const {
-	auto ptr							   = sio::object_message::create();
-	ptr->get_map()["xp"]				   = sio::double_message::create(xp);
-	ptr->get_map()["yp"]				   = sio::double_message::create(yp);
-	ptr->get_map()["xv"]				   = sio::double_message::create(xv);
-	ptr->get_map()["yv"]				   = sio::double_message::create(yv);
-	ptr->get_map()["sx"]				   = sio::double_message::create(sx);
-	ptr->get_map()["sy"]				   = sio::double_message::create(sy);
-	ptr->get_map()["climbing"]			   = sio::bool_message::create(climbing);
-	ptr->get_map()["dashing"]			   = sio::bool_message::create(dashing);
-	ptr->get_map()["jumping"]			   = sio::bool_message::create(jumping);
-	ptr->get_map()["dash_dir"]			   = sio::int_message::create(static_cast<int>(dash_dir));
-	ptr->get_map()["climbing_facing"]	   = sio::int_message::create(static_cast<int>(climbing_facing));
-	ptr->get_map()["since_wallkick"]	   = sio::int_message::create(since_wallkick.asMilliseconds());
-	ptr->get_map()["time_airborne"]		   = sio::int_message::create(time_airborne.asMilliseconds());
-	ptr->get_map()["this_frame"]		   = sio::int_message::create(int(this_frame));
-	ptr->get_map()["last_frame"]		   = sio::int_message::create(int(last_frame));
-	ptr->get_map()["grounded"]			   = sio::bool_message::create(grounded);
-	ptr->get_map()["facing"]			   = sio::int_message::create(static_cast<int>(facing));
-	ptr->get_map()["against_ladder_left"]  = sio::bool_message::create(against_ladder_left);
-	ptr->get_map()["against_ladder_right"] = sio::bool_message::create(against_ladder_right);
-	ptr->get_map()["can_wallkick_left"]	   = sio::bool_message::create(can_wallkick_left);
-	ptr->get_map()["can_wallkick_right"]   = sio::bool_message::create(can_wallkick_right);
-	ptr->get_map()["on_ice"]			   = sio::bool_message::create(on_ice);
-	ptr->get_map()["flip_gravity"]		   = sio::bool_message::create(flip_gravity);
-	ptr->get_map()["alt_controls"]		   = sio::bool_message::create(alt_controls);
-	ptr->get_map()["tile_above"]		   = sio::bool_message::create(tile_above);
-	return ptr;
-}
-
-world::control_vars world::control_vars::from_message(const sio::message::ptr& msg) {
+// fixed point scales for the packed control vars
+static constexpr float POS_SCALE   = 4096.f;   // 1/4096th of a tile
+static constexpr float VEL_SCALE   = 256.f;	   // 1/256th of a tile per second
+static constexpr float SCALE_SCALE = 1024.f;
+
+template <typename T>
+static T quantize(float v, float scale) {
+	float q = std::round(v * scale);
+	q		= std::clamp(q, float(std::numeric_limits<T>::min()), float(std::numeric_limits<T>::max()));
+	return static_cast<T>(q);
+}
+
+static uint16_t pack_ms(sf::Time t) {
+	// timers only matter for the first few seconds, saturate the rest
+	return static_cast<uint16_t>(std::clamp(t.asMilliseconds(), 0, 0xffff));
+}
+
+// layout, little-endian:
+//  i32 xp, yp | i16 xv, yv | i16 sx, sy | u16 flags | u8 facing, dash_dir, climbing_facing (2 bits each)
+//  u8 this_frame | u8 last_frame | u16 since_wallkick, time_airborne (ms)
+void world::control_vars::pack(byte_writer& w) const {
+	w.write(quantize<int32_t>(xp, POS_SCALE));
+	w.write(quantize<int32_t>(yp, POS_SCALE));
+	w.write(quantize<int16_t>(xv, VEL_SCALE));
+	w.write(quantize<int16_t>(yv, VEL_SCALE));
+	w.write(quantize<int16_t>(sx, SCALE_SCALE));
+	w.write(quantize<int16_t>(sy, SCALE_SCALE));
+	uint16_t flags = 0;
+	flags |= climbing << 0;
+	flags |= dashing << 1;
+	flags |= jumping << 2;
+	flags |= grounded << 3;
+	flags |= against_ladder_left << 4;
+	flags |= against_ladder_right << 5;
+	flags |= can_wallkick_left << 6;
+	flags |= can_wallkick_right << 7;
+	flags |= on_ice << 8;
+	flags |= flip_gravity << 9;
+	flags |= alt_controls << 10;
+	flags |= tile_above << 11;
+	w.write(flags);
+	w.write(uint8_t((facing & 3) | (dash_dir & 3) << 2 | (climbing_facing & 3) << 4));
+	w.write(uint8_t(int(this_frame)));
+	w.write(uint8_t(int(last_frame)));
+	w.write(pack_ms(since_wallkick));
+	w.write(pack_ms(time_airborne));
+}
+
+world::control_vars world::control_vars::unpack(byte_reader& r) {
 	world::control_vars controls;
-	auto& data					  = msg->get_map();
-	controls.xp					  = data["xp"]->get_double();
-	controls.yp					  = data["yp"]->get_double();
-	controls.xv					  = data["xv"]->get_double();
-	controls.yv					  = data["yv"]->get_double();
-	controls.sx					  = data["sx"]->get_double();
-	controls.sy					  = data["sy"]->get_double();
-	controls.climbing			  = data["climbing"]->get_bool();
-	controls.dashing			  = data["dashing"]->get_bool();
-	controls.jumping			  = data["jumping"]->get_bool();
-	controls.dash_dir			  = static_cast<dir>(data["dash_dir"]->get_int());
-	controls.climbing_facing	  = static_cast<dir>(data["climbing_facing"]->get_int());
-	controls.since_wallkick		  = sf::milliseconds(data["since_wallkick"]->get_int());
-	controls.time_airborne		  = sf::milliseconds(data["time_airborne"]->get_int());
-	controls.this_frame			  = input_state::from_int(data["this_frame"]->get_int());
-	controls.last_frame			  = input_state::from_int(data["last_frame"]->get_int());
-	controls.grounded			  = data["grounded"]->get_bool();
-	controls.facing				  = static_cast<dir>(data["facing"]->get_int());
-	controls.against_ladder_left  = data["against_ladder_left"]->get_bool();
-	controls.against_ladder_right = data["against_ladder_right"]->get_bool();
-	controls.can_wallkick_left	  = data["can_wallkick_left"]->get_bool();
-	controls.can_wallkick_right	  = data["can_wallkick_right"]->get_bool();
-	controls.on_ice				  = data["on_ice"]->get_bool();
-	controls.flip_gravity		  = data["flip_gravity"]->get_bool();
-	controls.alt_controls		  = data["alt_controls"]->get_bool();
-	controls.tile_above			  = data["tile_above"]->get_bool();
-
+	controls.xp					  = r.read<int32_t>() / POS_SCALE;
+	controls.yp					  = r.read<int32_t>() / POS_SCALE;
+	controls.xv					  = r.read<int16_t>() / VEL_SCALE;
+	controls.yv					  = r.read<int16_t>() / VEL_SCALE;
+	controls.sx					  = r.read<int16_t>() / SCALE_SCALE;
+	controls.sy					  = r.read<int16_t>() / SCALE_SCALE;
+	uint16_t flags				  = r.read<uint16_t>();
+	controls.climbing			  = flags & (1 << 0);
+	controls.dashing			  = flags & (1 << 1);
+	controls.jumping			  = flags & (1 << 2);
+	controls.grounded			  = flags & (1 << 3);
+	controls.against_ladder_left  = flags & (1 << 4);
+	controls.against_ladder_right = flags & (1 << 5);
+	controls.can_wallkick_left	  = flags & (1 << 6);
+	controls.can_wallkick_right	  = flags & (1 << 7);
+	controls.on_ice				  = flags & (1 << 8);
+	controls.flip_gravity		  = flags & (1 << 9);
+	controls.alt_controls		  = flags & (1 << 10);
+	controls.tile_above			  = flags & (1 << 11);
+	uint8_t dirs				  = r.read<uint8_t>();
+	controls.facing				  = static_cast<dir>(dirs & 3);
+	controls.dash_dir			  = static_cast<dir>((dirs >> 2) & 3);
+	controls.climbing_facing	  = static_cast<dir>((dirs >> 4) & 3);
+	controls.this_frame			  = input_state::from_int(r.read<uint8_t>());
+	controls.last_frame			  = input_state::from_int(r.read<uint8_t>());
+	controls.since_wallkick		  = sf::milliseconds(r.read<uint16_t>());
+	controls.time_airborne		  = sf::milliseconds(r.read<uint16_t>());
 	return controls;
 }
 
-world::world(level l, std::optional<replay> rp)
+world::world(const level& l, std::optional<replay> rp)
 	: m_has_focus(true),
 	  m_tmap(l.map()),
 	  m_mt_mgr(m_tmap),
@@ -142,11 +163,12 @@ world::world(level l, std::optional<replay> rp)
 	m_game_over.setPosition(m_tmap.total_size() / 2.f);
 	m_fadeout.setPosition(m_tmap.total_size() / 2.f);
 
+#ifndef HEADLESS
 	m_dash_sfx_thread = std::jthread([this](std::stop_token stoken) {
 		using namespace std::chrono_literals;
 		sf::Sound s(resource::get().sound_buffer("dash"));
 		while (!stoken.stop_requested()) {
-			if (m_cvars.dashing && m_player_grounded() && std::abs(m_cvars.xv) > phys.xv_max && !lost() && !won()) {
+			if (!m_muted && m_cvars.dashing && m_player_grounded() && std::abs(m_cvars.xv) > phys.xv_max && !lost() && !won()) {
 				s.setVolume(context::get().sfx_volume());
 				s.play();
 				auto& sp		= m_pmgr.spawn<particles::smoke>();
@@ -157,11 +179,14 @@ world::world(level l, std::optional<replay> rp)
 			std::this_thread::sleep_for(120ms);
 		}
 	});
+#endif
 }
 
 world::~world() {
-	m_dash_sfx_thread.request_stop();
-	m_dash_sfx_thread.join();
+	if (m_dash_sfx_thread.joinable()) {
+		m_dash_sfx_thread.request_stop();
+		m_dash_sfx_thread.join();
+	}
 }
 
 sf::Vector2f world::get_player_pos() const {
@@ -198,12 +223,10 @@ world::control_vars world::get_player_control_vars() const {
 
 void world::m_init_world() {
 	// find the start position
-	auto& tiles		= m_tmap.get();
-	auto start_tile = std::find(tiles.cbegin(), tiles.cend(), tile::begin);
-	if (start_tile != tiles.cend()) {
-		int index = std::distance(tiles.cbegin(), start_tile);
-		m_start_x = index % m_tmap.size().x;
-		m_start_y = index / m_tmap.size().x;
+	sf::Vector2i start = m_tmap.find_first_of(tile::begin);
+	if (start.x != -1) {
+		m_start_x = start.x;
+		m_start_y = start.y;
 	}
 
 	// set the world up at the start
@@ -504,6 +527,7 @@ void world::run_controls(sf::Time dt, world::control_vars& v, particle_manager*
 }
 
 void world::step(sf::Time dt) {
+	resource::mute_guard quiet(m_muted);
 	// -1 if gravity is flipped. used for y velocity calculations
 
 	m_cstep++;
@@ -788,6 +812,44 @@ bool world::update(sf::Time dt) {
 	return stepped;
 }
 
+bool world::simulate(input_state in) {
+	m_cvars.this_frame = in;
+
+	// same end-of-run handling as update(), minus the fades
+	if (won()) {
+		if (!m_cvars.last_frame.jump && m_cvars.this_frame.jump) {
+			m_restart_world();
+		} else {
+			m_cvars.last_frame.jump = m_cvars.this_frame.jump;
+		}
+		return false;
+	} else if (lost()) {
+		if (m_cvars.last_frame.jump && !m_cvars.this_frame.jump) {
+			m_restart_world();
+		} else {
+			m_cvars.last_frame.jump = m_cvars.this_frame.jump;
+		}
+		return false;
+	}
+
+	m_first_input |= m_cvars.this_frame.left || m_cvars.this_frame.right || m_cvars.this_frame.jump || m_cvars.this_frame.dash || m_cvars.this_frame.down || m_cvars.this_frame.up;
+	if (!m_first_input) return false;
+
+	step(replay::timestep);
+	m_pmgr.update(replay::timestep);
+	// facing is read back off the sprite's scale next step
+	m_update_animation();
+	return true;
+}
+
+void world::restart() {
+	m_restart_world();
+}
+
+void world::set_muted(bool muted) {
+	m_muted = muted;
+}
+
 void world::control_vars::player_wallkick(dir d, particle_manager* pmgr) {
 	if (is_wallkick_locked()) return;
 	float xv_sign	= d == dir::left ? -1 : 1;
@@ -1056,6 +1118,7 @@ void world::m_player_win() {
 }
 
 void world::m_player_die() {
+#ifndef HEADLESS
 	debug::log() << "death report:\n";
 	debug::log() << "velocity = " << sf::Vector2f(m_cvars.xv, m_cvars.yv) << "\n";
 	debug::log() << "touching Y-: " << m_touching[int(dir::up)] << "\n";
@@ -1071,6 +1134,7 @@ void world::m_player_die() {
 				 << " r="
 				 << !!m_moving_platform_handle[3]
 				 << "\n";
+#endif
 	m_dead = true;
 	resource::get().play_sound("gameover");
 	m_end_alpha		= 0;
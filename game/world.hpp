@@ -4,24 +4,25 @@
 #include <SFML/Graphics/Rect.hpp>
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <functional>
 #include <optional>
 #include <thread>
 
 #include "level.hpp"
 #include "moving_tile.hpp"
+#include "net_buffer.hpp"
 #include "particles.hpp"
 #include "player.hpp"
 #include "replay.hpp"
 #include "resource.hpp"
 #include "settings.hpp"
-#include "sio_client.h"
 #include "tilemap.hpp"
 
 // takes in a level and renders it, as well as handles input and logic and physics and all things game-y :3
 class world : public sf::Drawable, public sf::Transformable {
 public:
-	world(level l, std::optional<replay> replay = {});
+	world(const level& l, std::optional<replay> replay = {});
 	~world();
 
 	enum dir {
@@ -31,8 +32,11 @@ public:
 		left  = 3
 	};
 
-	bool update(sf::Time dt);	// true if stepped
-	void step(sf::Time dt);		// handles physics stuff
+	bool update(sf::Time dt);		 // true if stepped
+	void step(sf::Time dt);			 // handles physics stuff
+	bool simulate(input_state in);	 // one timestep from the given inputs instead of the keyboard, true if stepped
+	void restart();					 // back to the start, as if restart was pressed
+	void set_muted(bool muted);		 // for worlds that are simulated but not seen, i.e. bots
 	void process_event(sf::Event e);
 
 	// all variables used for the pre-physics controls
@@ -71,8 +75,10 @@ public:
 		void player_wallkick(dir d, particle_manager* pmgr = nullptr);	 // walljump
 
 		static const control_vars empty;
-		sio::message::ptr to_message() const;
-		static control_vars from_message(const sio::message::ptr& msg);
+		// fixed-layout binary form sent to other players, see world.cpp for the layout
+		static constexpr std::size_t PACKED_SIZE = 25;
+		void pack(byte_writer& w) const;
+		static control_vars unpack(byte_reader& r);
 	};
 	static void run_controls(sf::Time dt, control_vars& v, particle_manager* pmgr = nullptr);
 
@@ -171,6 +177,7 @@ private:
 
 	// dashing produces a rythmic noise that the current update loop is not precise enough to handle
 	std::jthread m_dash_sfx_thread;
+	std::atomic<bool> m_muted = false;
 
 	void m_update_animation();		 // update the animation state of the player
 	void m_player_die();			 // run when the player dies
@@ -0,0 +1,36 @@
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "room_server.hpp"
+
+// bq-r-rooms [--port 3001] [--levels levels] [--threads n]
+int main(int argc, char** argv) {
+	unsigned short port = 3001;
+	std::string levels	= "levels";
+	std::size_t threads = std::thread::hardware_concurrency();
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (std::strcmp(argv[i], "--port") == 0) {
+			port = std::atoi(argv[i + 1]);
+		} else if (std::strcmp(argv[i], "--levels") == 0) {
+			levels = argv[i + 1];
+		} else if (std::strcmp(argv[i], "--threads") == 0) {
+			threads = std::atoi(argv[i + 1]);
+		} else {
+			std::cerr << "unknown option " << argv[i] << "\n";
+			return 1;
+		}
+	}
+
+	try {
+		room_server server(port, levels, threads);
+		server.run();
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
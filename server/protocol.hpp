@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+messages between the room server and the game. each message is one sf::Packet (so a u32 length, then the body),
+the body being one of the kinds below followed by its fields, written with byte_writer
+
+client -> server
+	JOIN		i32 player id | i32 level id | u8 alt controls
+	INPUT		u32 seq of the first input | u8 count | count * u8 input_state
+	RESTART
+	LEAVE
+
+server -> client
+	SNAPSHOT	u16 count | count * (u32 inputs of that player simulated so far | multiplayer::player_state::pack())
+	JOIN_FAILED	i32 level id | u8 join_failure
+
+a player id is held by the connection that joined with it until it leaves or disconnects, and a JOIN for an id
+held by another connection fails with PLAYER_TAKEN. that only stops two connections sharing an id: nothing
+proves the id belongs to whoever sent it, so anyone can take an id that's free, and the real server would
+have to check it against the player's multiplayer token first
+*/
+namespace protocol {
+
+enum client_msg : uint8_t {
+	JOIN	= 1,
+	INPUT	= 2,
+	RESTART = 3,
+	LEAVE	= 4,
+};
+
+enum server_msg : uint8_t {
+	SNAPSHOT	= 1,
+	JOIN_FAILED = 2,
+};
+
+enum join_failure : uint8_t {
+	NO_LEVEL	 = 0,
+	PLAYER_TAKEN = 1,
+};
+
+}
@@ -0,0 +1,97 @@
+#include "room.hpp"
+
+#include "multiplayer.hpp"
+#include "net_buffer.hpp"
+#include "protocol.hpp"
+#include "util.hpp"
+
+room::room(int id, const std::string& level_code)
+	: m_id(id) {
+	m_level.map().load(level_code);
+}
+
+int room::id() const {
+	return m_id;
+}
+
+std::size_t room::size() const {
+	return m_members.size();
+}
+
+bool room::empty() const {
+	return m_members.empty();
+}
+
+void room::join(int player, bool alt) {
+	// playback with no frames, so the world takes its control scheme & colors from it rather than the local context
+	replay rp;
+	rp.set_alt(alt);
+	m_members[player] = member{
+		.w		  = std::make_unique<world>(m_level, rp),
+		.inputs	  = {},
+		.last	  = input_state(),
+		.next_seq = 0,
+		.acked	  = 0,
+	};
+}
+
+void room::leave(int player) {
+	m_members.erase(player);
+}
+
+void room::restart(int player) {
+	auto it = m_members.find(player);
+	if (it == m_members.end()) return;
+	it->second.w->restart();
+	it->second.inputs.clear();
+	it->second.last = input_state();
+}
+
+void room::push_inputs(int player, uint32_t seq, const std::vector<input_state>& inputs) {
+	auto it = m_members.find(player);
+	if (it == m_members.end()) return;
+	member& m = it->second;
+	for (std::size_t i = 0; i < inputs.size(); ++i) {
+		// already have it, a resend
+		if (seq + i < m.next_seq) continue;
+		m.inputs.push_back(inputs[i]);
+		m.next_seq = seq + i + 1;
+	}
+	// a client can't buy itself extra steps by sending faster than real time
+	while (m.inputs.size() > MAX_QUEUED) {
+		m.inputs.pop_front();
+		m.acked++;
+	}
+}
+
+void room::tick() {
+	for (auto& [id, m] : m_members) {
+		// nothing arrived in time, assume they're still holding whatever they held
+		if (!m.inputs.empty()) {
+			m.last = m.inputs.front();
+			m.inputs.pop_front();
+			m.acked++;
+		}
+		m.w->simulate(m.last);
+	}
+}
+
+std::string room::snapshot() const {
+	std::string out;
+	out.reserve(1 + 2 + m_members.size() * (4 + multiplayer::player_state::PACKED_SIZE));
+	byte_writer w(out);
+	w.write(uint8_t(protocol::SNAPSHOT));
+	w.write(uint16_t(m_members.size()));
+	uint64_t now = util::get_time();
+	for (auto& [id, m] : m_members) {
+		multiplayer::player_state s{
+			.id		   = id,
+			.controls  = m.w->get_player_control_vars(),
+			.anim	   = m.w->get_player_anim(),
+			.updatedAt = now,
+		};
+		w.write(uint32_t(m.acked));
+		out += s.pack();
+	}
+	return out;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "level.hpp"
+#include "replay.hpp"
+#include "world.hpp"
+
+/// everyone playing one level, simulated from their inputs rather than trusting the states they'd report.
+/// not thread safe, a room is only ever touched by the worker that owns it
+class room {
+public:
+	room(int id, const std::string& level_code);
+
+	int id() const;
+	std::size_t size() const;	// players in the room
+	bool empty() const;
+
+	void join(int player, bool alt);
+	void leave(int player);
+	void restart(int player);
+	// queue a player's inputs for their next timesteps, seq being the client's count of the first one
+	void push_inputs(int player, uint32_t seq, const std::vector<input_state>& inputs);
+
+	void tick();   // steps everyone once, replay::timestep long
+
+	// every player's state as of now, see protocol.hpp for the layout
+	std::string snapshot() const;
+
+	// inputs queued beyond this are from a client running fast, the oldest are dropped
+	static constexpr std::size_t MAX_QUEUED = 25;
+
+private:
+	struct member {
+		std::unique_ptr<world> w;
+		std::deque<input_state> inputs;	  // not yet simulated, oldest first
+		input_state last;				  // repeated whenever the queue runs dry
+		uint32_t next_seq;				  // seq the next pushed input should have
+		uint32_t acked;					  // how many inputs have been simulated or dropped, i.e. the seq of the next one
+	};
+
+	int m_id;
+	level m_level;
+	std::unordered_map<int, member> m_members;
+};
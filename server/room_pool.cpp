@@ -0,0 +1,148 @@
+#include "room_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+#include "debug.hpp"
+
+const sf::Time room_pool::SNAPSHOT_INTERVAL = sf::milliseconds(50);
+
+room_pool::room_pool(std::size_t threads) {
+	threads = std::max<std::size_t>(threads, 1);
+	for (std::size_t i = 0; i < threads; ++i) {
+		m_workers.push_back(std::make_unique<worker>());
+	}
+	for (std::size_t i = 0; i < threads; ++i) {
+		m_threads.emplace_back([this, i](std::stop_token stoken) { m_work(*m_workers[i], stoken); });
+	}
+}
+
+room_pool::~room_pool() {
+	// the threads touch the outbox, stop them before any of it goes away
+	for (auto& t : m_threads) {
+		t.request_stop();
+	}
+	for (auto& t : m_threads) {
+		t.join();
+	}
+}
+
+void room_pool::join(int room_id, int player, bool alt, const std::string& level_code) {
+	m_push(command{ .kind = command::JOIN, .room_id = room_id, .player = player, .alt = alt, .level_code = level_code });
+}
+
+void room_pool::leave(int room_id, int player) {
+	m_push(command{ .kind = command::LEAVE, .room_id = room_id, .player = player });
+}
+
+void room_pool::restart(int room_id, int player) {
+	m_push(command{ .kind = command::RESTART, .room_id = room_id, .player = player });
+}
+
+void room_pool::push_inputs(int room_id, int player, uint32_t seq, std::vector<input_state> inputs) {
+	m_push(command{ .kind = command::INPUT, .room_id = room_id, .player = player, .seq = seq, .inputs = std::move(inputs) });
+}
+
+std::vector<room_pool::snapshot> room_pool::take_snapshots() {
+	std::vector<snapshot> out;
+	std::lock_guard<std::mutex> guard(m_outbox_mutex);
+	std::swap(out, m_outbox);
+	return out;
+}
+
+room_pool::stats room_pool::get_stats() {
+	stats s{ .rooms = 0, .players = 0, .load = 0, .behind = 0 };
+	int64_t elapsed_us = std::max<int64_t>(m_stats_clock.restart().asMicroseconds(), 1);
+	for (auto& w : m_workers) {
+		s.rooms += w->room_count;
+		s.players += w->player_count;
+		s.load = std::max(s.load, float(w->busy_us.exchange(0)) / float(elapsed_us));
+		s.behind += w->behind.exchange(0);
+	}
+	return s;
+}
+
+void room_pool::m_push(command&& cmd) {
+	// unsigned, so a negative id can't give a negative index
+	worker& w = *m_workers[std::size_t(cmd.room_id) % m_workers.size()];
+	std::lock_guard<std::mutex> guard(w.mutex);
+	w.inbox.push_back(std::move(cmd));
+}
+
+void room_pool::m_apply(worker& w, command& cmd) {
+	auto it = w.rooms.find(cmd.room_id);
+	if (it == w.rooms.end()) {
+		if (cmd.kind != command::JOIN) return;
+		it = w.rooms.emplace(cmd.room_id, std::make_unique<room>(cmd.room_id, cmd.level_code)).first;
+		debug::log() << "room " << cmd.room_id << " opened\n";
+	}
+	room& r = *it->second;
+	switch (cmd.kind) {
+	case command::JOIN:
+		r.join(cmd.player, cmd.alt);
+		break;
+	case command::LEAVE:
+		r.leave(cmd.player);
+		if (r.empty()) {
+			w.rooms.erase(it);
+			debug::log() << "room " << cmd.room_id << " closed\n";
+		}
+		break;
+	case command::RESTART:
+		r.restart(cmd.player);
+		break;
+	case command::INPUT:
+		r.push_inputs(cmd.player, cmd.seq, cmd.inputs);
+		break;
+	}
+}
+
+void room_pool::m_work(worker& w, std::stop_token stoken) {
+	using clock = std::chrono::steady_clock;
+	const auto tick			= std::chrono::microseconds(replay::timestep.asMicroseconds());
+	const int snapshot_each = SNAPSHOT_INTERVAL.asMicroseconds() / replay::timestep.asMicroseconds();
+	auto next				= clock::now();
+	int ticks				= 0;
+	std::vector<command> commands;
+	std::vector<snapshot> snapshots;
+	while (!stoken.stop_requested()) {
+		{
+			std::lock_guard<std::mutex> guard(w.mutex);
+			std::swap(commands, w.inbox);
+		}
+
+		auto begin = clock::now();
+		for (auto& cmd : commands) {
+			m_apply(w, cmd);
+		}
+		commands.clear();
+
+		bool snapshot_due	= ++ticks % snapshot_each == 0;
+		std::size_t players = 0;
+		for (auto& [id, r] : w.rooms) {
+			r->tick();
+			players += r->size();
+			if (snapshot_due) {
+				snapshots.push_back({ .room_id = id, .data = r->snapshot() });
+			}
+		}
+		if (!snapshots.empty()) {
+			std::lock_guard<std::mutex> guard(m_outbox_mutex);
+			std::move(snapshots.begin(), snapshots.end(), std::back_inserter(m_outbox));
+			snapshots.clear();
+		}
+		w.room_count   = w.rooms.size();
+		w.player_count = players;
+		w.busy_us += std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - begin).count();
+
+		next += tick;
+		auto now = clock::now();
+		if (now > next + tick * 10) {
+			// too far behind to catch up, let the rooms run slow rather than spiral
+			w.behind += (now - next) / tick;
+			next = now;
+		}
+		std::this_thread::sleep_until(next);
+	}
+}
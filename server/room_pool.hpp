@@ -0,0 +1,87 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "replay.hpp"
+#include "room.hpp"
+
+/// runs rooms on a fixed set of worker threads, each ticking all of its rooms every replay::timestep.
+/// a room lives on worker (id % workers) for its whole life, so simulations never take a lock;
+/// the only shared state is each worker's inbox of commands, and the outbox of snapshots
+class room_pool {
+public:
+	room_pool(std::size_t threads);
+	~room_pool();
+
+	// a room is made on the first join, from the level code passed along. it's dropped once the last player leaves
+	void join(int room_id, int player, bool alt, const std::string& level_code);
+	void leave(int room_id, int player);
+	void restart(int room_id, int player);
+	void push_inputs(int room_id, int player, uint32_t seq, std::vector<input_state> inputs);
+
+	struct snapshot {
+		int room_id;
+		std::string data;
+	};
+	// snapshots taken since the last call, oldest first
+	std::vector<snapshot> take_snapshots();
+
+	struct stats {
+		std::size_t rooms;
+		std::size_t players;
+		float load;		   // fraction of the tick budget the busiest worker spent simulating, since the last call
+		uint64_t behind;   // ticks skipped because a worker couldn't keep up, since the last call
+	};
+	stats get_stats();
+
+	static const sf::Time SNAPSHOT_INTERVAL;
+
+private:
+	room_pool(const room_pool& other) = delete;
+	room_pool(room_pool&& other)	  = delete;
+
+	struct command {
+		enum kind_t {
+			JOIN,
+			LEAVE,
+			RESTART,
+			INPUT,
+		} kind;
+		int room_id;
+		int player;
+		bool alt;
+		std::string level_code;	  // join only
+		uint32_t seq;			  // input only
+		std::vector<input_state> inputs;
+	};
+
+	struct worker {
+		std::mutex mutex;
+		std::vector<command> inbox;
+		std::unordered_map<int, std::unique_ptr<room>> rooms;	// only touched by the worker's thread
+		std::atomic<std::size_t> room_count	  = 0;
+		std::atomic<std::size_t> player_count = 0;
+		std::atomic<int64_t> busy_us		  = 0;	 // time spent ticking
+		std::atomic<uint64_t> behind		  = 0;
+	};
+
+	std::vector<std::unique_ptr<worker>> m_workers;
+	std::vector<std::jthread> m_threads;
+
+	std::mutex m_outbox_mutex;
+	std::vector<snapshot> m_outbox;
+
+	sf::Clock m_stats_clock;
+
+	void m_push(command&& cmd);
+	void m_apply(worker& w, command& cmd);
+	void m_work(worker& w, std::stop_token stoken);	  // worker thread loop
+};
@@ -0,0 +1,217 @@
+#include "room_server.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "debug.hpp"
+#include "net_buffer.hpp"
+#include "protocol.hpp"
+
+room_server::room_server(unsigned short port, std::string level_dir, std::size_t threads)
+	: m_pool(threads),
+	  m_level_dir(level_dir) {
+	if (m_listener.listen(port) != sf::Socket::Done) {
+		throw std::runtime_error("could not listen on port " + std::to_string(port));
+	}
+	m_selector.add(m_listener);
+	debug::log() << "listening on " << port << " with " << threads << " room threads\n";
+}
+
+void room_server::run() {
+	for (;;) {
+		// short wait, snapshots need sending even when nobody's talking
+		if (m_selector.wait(sf::milliseconds(5))) {
+			if (m_selector.isReady(m_listener)) {
+				m_accept();
+			}
+			for (auto& c : m_connections) {
+				if (!c.closed && m_selector.isReady(*c.socket)) {
+					m_receive(c);
+				}
+			}
+		}
+		m_broadcast();
+		for (auto& c : m_connections) {
+			m_flush(c);
+		}
+		m_reap();
+
+		if (m_stats_clock.getElapsedTime() > sf::seconds(10)) {
+			m_stats_clock.restart();
+			room_pool::stats s = m_pool.get_stats();
+			debug::log() << s.rooms << " rooms, "
+						 << s.players << " players, "
+						 << int(s.load * 100) << "% busiest worker load, "
+						 << s.behind << " ticks dropped\n";
+		}
+	}
+}
+
+void room_server::m_accept() {
+	auto socket = std::make_unique<sf::TcpSocket>();
+	if (m_listener.accept(*socket) != sf::Socket::Done) return;
+	// a slow client shouldn't hold up the rest, what can't be sent now waits in its queue
+	socket->setBlocking(false);
+	m_selector.add(*socket);
+	m_connections.push_back(connection{
+		.socket	  = std::move(socket),
+		.outgoing = {},
+		.player	  = -1,
+		.room_id  = -1,
+		.closed	  = false,
+	});
+}
+
+void room_server::m_receive(connection& c) {
+	// a non-blocking socket hands back whole packets only, holding on to partial ones between calls
+	sf::Packet packet;
+	for (;;) {
+		sf::Socket::Status status = c.socket->receive(packet);
+		if (status == sf::Socket::Done) {
+			m_handle(c, packet);
+			packet.clear();
+		} else if (status == sf::Socket::Disconnected || status == sf::Socket::Error) {
+			c.closed = true;
+			return;
+		} else {
+			return;
+		}
+	}
+}
+
+void room_server::m_handle(connection& c, const sf::Packet& packet) {
+	byte_reader r(static_cast<const char*>(packet.getData()), packet.getDataSize());
+	switch (r.read<uint8_t>()) {
+	case protocol::JOIN: {
+		int player	 = r.read<int32_t>();
+		int level_id = r.read<int32_t>();
+		bool alt	 = r.read<uint8_t>();
+		if (r.failed() || player < 0) break;
+		// the stand-in takes the player's word for who they are, so long as nobody else has already joined as them.
+		// see protocol.hpp for what that leaves open
+		auto owner = m_owners.find(player);
+		if (owner != m_owners.end() && owner->second != &c) {
+			debug::log() << "refusing a second connection as player " << player << "\n";
+			m_join_failed(c, level_id, protocol::PLAYER_TAKEN);
+			break;
+		}
+		m_leave(c);
+		std::optional<std::string> code = m_level_code(level_id);
+		if (!code) {
+			m_join_failed(c, level_id, protocol::NO_LEVEL);
+			break;
+		}
+		c.player		 = player;
+		c.room_id		 = level_id;
+		m_owners[player] = &c;
+		m_members[level_id].push_back(&c);
+		m_pool.join(level_id, player, alt, *code);
+		break;
+	}
+	case protocol::INPUT: {
+		uint32_t seq  = r.read<uint32_t>();
+		uint8_t count = r.read<uint8_t>();
+		std::vector<input_state> inputs;
+		inputs.reserve(count);
+		for (int i = 0; i < count; ++i) {
+			inputs.push_back(input_state::from_int(r.read<uint8_t>()));
+		}
+		if (r.failed() || c.player == -1) break;
+		m_pool.push_inputs(c.room_id, c.player, seq, std::move(inputs));
+		break;
+	}
+	case protocol::RESTART:
+		if (c.player == -1) break;
+		m_pool.restart(c.room_id, c.player);
+		break;
+	case protocol::LEAVE:
+		m_leave(c);
+		break;
+	default:
+		// not speaking the protocol
+		c.closed = true;
+		break;
+	}
+}
+
+void room_server::m_leave(connection& c) {
+	if (c.player == -1) return;
+	m_pool.leave(c.room_id, c.player);
+	auto& members = m_members[c.room_id];
+	members.erase(std::remove(members.begin(), members.end(), &c), members.end());
+	if (members.empty()) {
+		m_members.erase(c.room_id);
+	}
+	m_owners.erase(c.player);
+	c.player  = -1;
+	c.room_id = -1;
+}
+
+void room_server::m_join_failed(connection& c, int level_id, uint8_t reason) {
+	std::string out;
+	byte_writer w(out);
+	w.write(uint8_t(protocol::JOIN_FAILED));
+	w.write(int32_t(level_id));
+	w.write(reason);
+	m_send(c, out);
+}
+
+void room_server::m_send(connection& c, const std::string& data) {
+	if (c.closed) return;
+	if (c.outgoing.size() >= MAX_QUEUED_PACKETS) {
+		debug::log() << "player " << c.player << " can't keep up, disconnecting\n";
+		c.closed = true;
+		return;
+	}
+	c.outgoing.emplace_back();
+	c.outgoing.back().append(data.data(), data.size());
+}
+
+void room_server::m_flush(connection& c) {
+	while (!c.closed && !c.outgoing.empty()) {
+		// sfml remembers how much of a packet went out, so a partial send is resumed by sending it again
+		sf::Socket::Status status = c.socket->send(c.outgoing.front());
+		if (status == sf::Socket::Done) {
+			c.outgoing.pop_front();
+		} else if (status == sf::Socket::Disconnected || status == sf::Socket::Error) {
+			c.closed = true;
+		} else {
+			break;
+		}
+	}
+}
+
+void room_server::m_broadcast() {
+	for (auto& s : m_pool.take_snapshots()) {
+		auto it = m_members.find(s.room_id);
+		if (it == m_members.end()) continue;
+		for (connection* c : it->second) {
+			m_send(*c, s.data);
+		}
+	}
+}
+
+void room_server::m_reap() {
+	for (auto it = m_connections.begin(); it != m_connections.end();) {
+		if (it->closed) {
+			m_leave(*it);
+			m_selector.remove(*it->socket);
+			it = m_connections.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+std::optional<std::string> room_server::m_level_code(int level_id) {
+	auto it = m_level_codes.find(level_id);
+	if (it != m_level_codes.end()) return it->second;
+	std::ifstream file(m_level_dir + "/" + std::to_string(level_id) + ".txt");
+	if (!file) return {};
+	std::string code;
+	file >> code;
+	if (code.empty()) return {};
+	m_level_codes[level_id] = code;
+	return code;
+}
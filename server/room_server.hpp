@@ -0,0 +1,59 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <deque>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "room_pool.hpp"
+
+/// accepts game connections over tcp, forwards what they send to the room pool, and sends each room's snapshots
+/// back out to the players in it. all sockets are serviced from the one thread that calls run()
+class room_server {
+public:
+	// levels are read from <level_dir>/<level id>.txt, holding the level's code
+	room_server(unsigned short port, std::string level_dir, std::size_t threads);
+
+	void run();	  // blocks forever
+
+	// packets queued for a client beyond this and it's cut off, rather than stalling everyone else
+	static constexpr std::size_t MAX_QUEUED_PACKETS = 64;
+
+private:
+	struct connection {
+		std::unique_ptr<sf::TcpSocket> socket;
+		std::deque<sf::Packet> outgoing;   // front may be partially sent
+		int player;						   // -1 until joined
+		int room_id;
+		bool closed;
+	};
+
+	room_pool m_pool;
+	std::string m_level_dir;
+	std::unordered_map<int, std::string> m_level_codes;
+
+	sf::TcpListener m_listener;
+	sf::SocketSelector m_selector;
+	std::list<connection> m_connections;
+	std::unordered_map<int, std::vector<connection*>> m_members;   // connections in each room
+	std::unordered_map<int, connection*> m_owners;				   // the connection holding each player id
+
+	sf::Clock m_stats_clock;
+
+	void m_accept();
+	void m_receive(connection& c);
+	void m_handle(connection& c, const sf::Packet& packet);
+	void m_leave(connection& c);
+	void m_join_failed(connection& c, int level_id, uint8_t reason);
+	void m_send(connection& c, const std::string& data);
+	void m_flush(connection& c);
+	void m_broadcast();
+	void m_reap();	 // drop closed connections
+
+	// the level code for the given id, empty if there isn't one
+	std::optional<std::string> m_level_code(int level_id);
+};
@@ -0,0 +1,154 @@
+// plays a replay's inputs through a room the way clients send them, in batches with resends, and checks every player
+// ends up exactly where a world stepping the replay directly does. then times one worker's worth of rooms, reporting
+// how many it keeps up with
+//
+// usage: room-sim-test <level code file> <replay file> [rooms] [players per room]
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "level.hpp"
+#include "multiplayer.hpp"
+#include "net_buffer.hpp"
+#include "protocol.hpp"
+#include "replay.hpp"
+#include "room.hpp"
+#include "room_pool.hpp"
+#include "world.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+	if (ok) return;
+	std::printf("failed: %s\n", what.c_str());
+	++failures;
+}
+
+std::string read_file(const char* path) {
+	std::ifstream file(path);
+	std::stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
+
+std::vector<input_state> inputs_of(const replay& rp, std::size_t from, std::size_t count) {
+	std::vector<input_state> out;
+	for (std::size_t i = from; i < from + count && i < rp.size(); ++i) {
+		out.push_back(rp.get(i));
+	}
+	return out;
+}
+
+// how often each of the room's players sends its inputs, in timesteps
+constexpr std::size_t BATCHES[] = { 1, 5, 20 };
+
+void test_matches_replay(const std::string& code, const replay& rp) {
+	level lvl;
+	lvl.map().load(code);
+	world reference(lvl, rp);
+	for (std::size_t i = 0; i < rp.size(); ++i) {
+		reference.simulate(rp.get(i));
+	}
+	multiplayer::player_state want{
+		.id		   = 0,
+		.controls  = reference.get_player_control_vars(),
+		.anim	   = reference.get_player_anim(),
+		.updatedAt = 0,
+	};
+
+	room r(1, code);
+	for (int p = 0; p < int(std::size(BATCHES)); ++p) {
+		r.join(p, rp.alt());
+	}
+	for (std::size_t i = 0; i < rp.size(); ++i) {
+		for (int p = 0; p < int(std::size(BATCHES)); ++p) {
+			std::size_t batch = BATCHES[p];
+			if (i % batch != 0) continue;
+			// the previous batch again, as a client resends whatever hasn't been acked yet
+			if (i >= batch) r.push_inputs(p, i - batch, inputs_of(rp, i - batch, batch));
+			r.push_inputs(p, i, inputs_of(rp, i, batch));
+		}
+		r.tick();
+	}
+
+	std::string snap = r.snapshot();
+	byte_reader rd(snap.data(), snap.size());
+	check(rd.read<uint8_t>() == protocol::SNAPSHOT, "a snapshot starts with its kind");
+	uint16_t count = rd.read<uint16_t>();
+	check(count == std::size(BATCHES), "every player is in the snapshot");
+	for (uint16_t i = 0; i < count && !rd.failed(); ++i) {
+		uint32_t acked = rd.read<uint32_t>();
+		auto st		   = multiplayer::player_state::unpack(rd);
+		if (!st || st->id < 0 || st->id >= int(std::size(BATCHES))) {
+			check(false, "snapshot states unpack as one of the players that joined");
+			break;
+		}
+		std::string who = "player " + std::to_string(st->id) + " sending every " + std::to_string(BATCHES[st->id]) + " steps";
+		check(acked == rp.size(), who + " had all " + std::to_string(rp.size()) + " inputs simulated, not " + std::to_string(acked));
+		want.id = st->id;
+		check(multiplayer::player_state::same_packed(st->pack(), want.pack()), who + " ends where the replay does");
+	}
+	std::printf("replay of %zu steps ends at (%.2f, %.2f) in the room & the reference\n", rp.size(),
+				reference.get_player_control_vars().xp, reference.get_player_control_vars().yp);
+}
+
+// one worker's loop, without the waiting: every room ticks each step, & snapshots are taken as often as the pool does
+void load_run(const std::string& code, const replay& rp, int rooms, int players) {
+	std::vector<std::unique_ptr<room>> all;
+	for (int i = 0; i < rooms; ++i) {
+		all.push_back(std::make_unique<room>(i, code));
+		for (int p = 0; p < players; ++p) {
+			all.back()->join(p, rp.alt());
+		}
+	}
+
+	const std::size_t snapshot_each = room_pool::SNAPSHOT_INTERVAL.asMicroseconds() / replay::timestep.asMicroseconds();
+	std::size_t snapshot_bytes		= 0;
+	auto start						= std::chrono::steady_clock::now();
+	for (std::size_t step = 0; step < rp.size(); ++step) {
+		for (auto& r : all) {
+			if (step % room::MAX_QUEUED == 0) {
+				for (int p = 0; p < players; ++p) {
+					r->push_inputs(p, step, inputs_of(rp, step, room::MAX_QUEUED));
+				}
+			}
+			r->tick();
+			if ((step + 1) % snapshot_each == 0) snapshot_bytes += r->snapshot().size();
+		}
+	}
+	double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+	double tick_us	 = elapsed_us / rp.size();
+	double budget_us = replay::timestep.asMicroseconds();
+	std::printf("load: %d rooms x %d players, %zu ticks, %.1f us per tick of all rooms (%.1f%% of the %.0f us budget), %zu snapshot bytes\n",
+				rooms, players, rp.size(), tick_us, 100 * tick_us / budget_us, budget_us, snapshot_bytes);
+	std::printf("load: one worker keeps up with about %.0f rooms of %d players, %.0f players\n",
+				rooms * budget_us / tick_us, players, rooms * players * budget_us / tick_us);
+}
+
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::printf("usage: %s <level code file> <replay file> [rooms] [players per room]\n", argv[0]);
+		return 2;
+	}
+	std::string code = read_file(argv[1]);
+	replay rp;
+	rp.load_from_file(argv[2]);
+	int rooms	= argc > 3 ? std::stoi(argv[3]) : 50;
+	int players = argc > 4 ? std::stoi(argv[4]) : 8;
+
+	test_matches_replay(code, rp);
+	load_run(code, rp, rooms, players);
+	std::printf("%d failures\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// hammers spsc_ring from a producer & a consumer thread the way multiplayer's socket events use it, checking
+// nothing is lost, duplicated or reordered. built with thread sanitizer, which fails the run on any data race
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "spsc_ring.hpp"
+
+namespace {
+
+struct event {
+	bool droppable;	  // like a state update, skipped when the ring's full rather than waited on
+	uint64_t seq;
+	std::string payload;   // heap allocated, so a slot handed over early shows up as a race on its buffer
+};
+
+constexpr uint64_t EVENTS = 500'000;
+
+std::string payload_for(uint64_t seq) {
+	return "event #" + std::to_string(seq) + " with enough text to not fit in the small string buffer";
+}
+
+}
+
+int main() {
+	spsc_ring<event, 256> ring;
+	std::atomic<bool> done = false;
+	int failures		   = 0;
+
+	std::thread producer([&]() {
+		for (uint64_t seq = 0; seq < EVENTS; ++seq) {
+			event ev{ .droppable = seq % 3 != 0, .seq = seq, .payload = payload_for(seq) };
+			if (ev.droppable) {
+				ring.push(std::move(ev));
+				continue;
+			}
+			while (!ring.push(std::move(ev))) {
+				std::this_thread::yield();
+			}
+		}
+		done = true;
+	});
+
+	// anyone may ask if it's empty
+	std::thread watcher([&]() {
+		uint64_t empties = 0;
+		while (!done) {
+			empties += ring.empty();
+			std::this_thread::yield();
+		}
+		std::printf("ring seen empty %llu times\n", (unsigned long long)empties);
+	});
+
+	uint64_t received = 0, kept = 0, next_kept = 0;
+	int64_t last	  = -1;
+	event ev;
+	for (;;) {
+		if (!ring.pop(ev)) {
+			if (done && ring.empty()) break;
+			std::this_thread::yield();
+			continue;
+		}
+		++received;
+		if (int64_t(ev.seq) <= last) {
+			std::printf("event %llu arrived after %lld\n", (unsigned long long)ev.seq, (long long)last);
+			++failures;
+		}
+		last = ev.seq;
+		if (ev.payload != payload_for(ev.seq)) {
+			std::printf("event %llu arrived corrupted\n", (unsigned long long)ev.seq);
+			++failures;
+		}
+		if (!ev.droppable) {
+			if (ev.seq != next_kept) {
+				std::printf("event %llu was lost\n", (unsigned long long)next_kept);
+				++failures;
+			}
+			next_kept = ev.seq + 3;
+			++kept;
+		}
+	}
+
+	producer.join();
+	watcher.join();
+
+	uint64_t want_kept = (EVENTS + 2) / 3;
+	if (failures == 0 && kept != want_kept) {
+		std::printf("%llu of %llu events that can't be dropped arrived\n", (unsigned long long)kept, (unsigned long long)want_kept);
+		++failures;
+	}
+	std::printf("%llu of %llu events arrived, %d failures\n", (unsigned long long)received, (unsigned long long)EVENTS, failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+// round trips player states through pack & unpack, and state_update messages through the encoders multiplayer sends
+// with & the apply the loopback server runs them through, including the rejections that make the client resync
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "multiplayer.hpp"
+#include "net_buffer.hpp"
+
+namespace {
+
+using mp = multiplayer;
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+	if (ok) return;
+	std::printf("failed: %s\n", what);
+	++failures;
+}
+
+mp::player_state sample_state() {
+	mp::player_state s		  = mp::player_state::empty(42);
+	s.updatedAt				  = 1'700'000'000'123;
+	s.anim					  = "dash";
+	s.controls.xp			  = 412.25f;
+	s.controls.yp			  = -96.5f;
+	s.controls.xv			  = 3.5f;
+	s.controls.yv			  = -1.25f;
+	s.controls.dashing		  = true;
+	s.controls.grounded		  = false;
+	s.controls.on_ice		  = true;
+	s.controls.tile_above	  = true;
+	s.controls.since_wallkick = sf::milliseconds(250);
+	return s;
+}
+
+void test_pack() {
+	mp::player_state s = sample_state();
+	std::string packed = s.pack();
+	check(packed.size() == mp::player_state::PACKED_SIZE, "packed state is PACKED_SIZE bytes");
+
+	byte_reader r(packed.data(), packed.size());
+	auto back = mp::player_state::unpack(r);
+	check(back.has_value(), "packed state unpacks");
+	if (!back) return;
+	check(back->id == s.id, "id survives a round trip");
+	check(back->updatedAt == s.updatedAt, "updatedAt survives a round trip");
+	check(back->anim == s.anim, "anim survives a round trip");
+	check(std::abs(back->controls.xp - s.controls.xp) < 0.01f && std::abs(back->controls.yp - s.controls.yp) < 0.01f, "position survives a round trip");
+	check(back->controls.dashing && back->controls.on_ice && back->controls.tile_above && !back->controls.grounded, "flags survive a round trip");
+	check(back->pack() == packed, "repacking an unpacked state gives the same bytes");
+
+	mp::player_state unknown   = s;
+	unknown.anim			   = "not an animation";
+	std::string unknown_packed = unknown.pack();
+	byte_reader ur(unknown_packed.data(), unknown_packed.size());
+	auto unknown_back = mp::player_state::unpack(ur);
+	check(unknown_back && unknown_back->anim == "stand", "unknown animations unpack as stand");
+
+	std::string wrong_version = packed;
+	wrong_version[0]		  = char(mp::player_state::VERSION + 1);
+	byte_reader vr(wrong_version.data(), wrong_version.size());
+	check(!mp::player_state::unpack(vr), "a state of another version doesn't unpack");
+
+	byte_reader sr(packed.data(), packed.size() - 1);
+	check(!mp::player_state::unpack(sr), "a state cut short doesn't unpack");
+
+	mp::player_state later = s;
+	later.updatedAt += 500;
+	check(mp::player_state::same_packed(packed, later.pack()), "states differing only by updatedAt are the same");
+	later.controls.xp += 1;
+	check(!mp::player_state::same_packed(packed, later.pack()), "states differing by position aren't the same");
+}
+
+void test_updates() {
+	static_assert(mp::DELTA_MASK_SIZE == 5, "a state_update delta carries a 5 byte mask");
+
+	mp::player_state s = sample_state();
+	std::string first  = s.pack();
+
+	uint16_t seq = 0;
+	std::string stored;
+	check(mp::apply_update(mp::encode_keyframe(7, first), seq, stored) == mp::UPDATE_KEYFRAME, "a keyframe applies with nothing stored");
+	check(seq == 7 && stored == first, "a keyframe replaces the stored state & sequence");
+
+	check(mp::apply_update(mp::encode_heartbeat(7), seq, stored) == mp::UPDATE_HEARTBEAT, "a heartbeat of the stored sequence applies");
+	check(seq == 7 && stored == first, "a heartbeat changes nothing");
+	check(!mp::apply_update(mp::encode_heartbeat(6), seq, stored), "a heartbeat of another sequence is rejected");
+
+	// the position & the animation change, the animation being the last byte so it's flagged in the mask's last byte
+	mp::player_state moved = s;
+	moved.controls.xp += 8;
+	moved.anim			= "climb";
+	std::string second	= moved.pack();
+	std::string delta	= mp::encode_delta(7, first, second);
+	std::size_t changed = 0;
+	for (std::size_t i = 0; i < second.size(); ++i) {
+		changed += second[i] != first[i];
+	}
+	check(delta.size() == 5 + mp::DELTA_MASK_SIZE + changed, "a delta is its header, the mask & only the changed bytes");
+	check(uint8_t(delta[5 + mp::DELTA_MASK_SIZE - 1]) & (1 << ((mp::player_state::PACKED_SIZE - 1) % 8)), "the last byte is flagged in the mask's 5th byte");
+	check(mp::apply_update(delta, seq, stored) == mp::UPDATE_DELTA, "a delta on the stored state applies");
+	check(seq == 8 && stored == second, "a delta moves the stored state to the new one");
+
+	// what makes the server send state_resync, each leaving the stored state as it was
+	const std::string before = stored;
+	check(!mp::apply_update(mp::encode_delta(7, first, second), seq, stored), "a delta on an older state is rejected");
+	uint16_t none_seq = 0;
+	std::string none;
+	check(!mp::apply_update(mp::encode_delta(0, first, second), none_seq, none), "a delta with nothing stored is rejected");
+	check(!mp::apply_update(mp::encode_heartbeat(0), none_seq, none), "a heartbeat with nothing stored is rejected");
+	std::string cut = mp::encode_delta(8, second, first);
+	cut.pop_back();
+	check(!mp::apply_update(cut, seq, stored), "a delta missing changed bytes is rejected");
+	check(!mp::apply_update(mp::encode_delta(8, second, first) + "x", seq, stored), "a delta with trailing bytes is rejected");
+	check(!mp::apply_update(mp::encode_keyframe(9, first.substr(1)), seq, stored), "a short keyframe is rejected");
+	std::string wrong_version = first;
+	wrong_version[0]		  = char(mp::player_state::VERSION + 1);
+	check(!mp::apply_update(mp::encode_keyframe(9, wrong_version), seq, stored), "a keyframe of another version is rejected");
+	check(!mp::apply_update(std::string(1, char(3)) + "ab", seq, stored), "an unknown kind is rejected");
+	check(seq == 8 && stored == before, "rejected updates leave the stored state alone");
+
+	// the client's answer to state_resync, a keyframe whatever the server has
+	check(mp::apply_update(mp::encode_keyframe(9, first), seq, stored) == mp::UPDATE_KEYFRAME, "a resync keyframe applies over a stored state");
+	check(seq == 9 && stored == first, "a resync keyframe replaces the stored state");
+
+	// sequence numbers wrap
+	seq = 65535;
+	check(mp::apply_update(mp::encode_delta(65535, first, second), seq, stored) == mp::UPDATE_DELTA && seq == 0, "a delta after sequence 65535 is sequence 0");
+
+	// a delta of no changes is only the header & an empty mask
+	std::string empty_delta = mp::encode_delta(0, second, second);
+	check(empty_delta.size() == 5 + mp::DELTA_MASK_SIZE, "a delta of nothing is the header & mask");
+	check(mp::apply_update(empty_delta, seq, stored) == mp::UPDATE_DELTA && stored == second, "a delta of nothing applies");
+}
+
+}
+
+int main() {
+	test_pack();
+	test_updates();
+	std::printf("%d failures\n", failures);
+	return failures == 0 ? 0 : 1;
+}